@@ -0,0 +1,393 @@
+#include "../common.h"
+
+#define ROUNDS  20000
+#define  CONTENTION_NS  200000000L
+#define SAMPLES_PER_CHILD  4096
+#define  MAX_CHILDREN  64
+#define SPIN_LIMIT   100
+#define  OUTSIDE_WORK  200
+
+#define WAKE_SERVER  0
+#define  WAKE_SEMAPHORE  1
+#define WAKE_FUTEX   2
+#define  WAKE_SPIN  3
+#define WAKE_EVENTFD  4
+#define  WAKE_PIPE   5
+
+#define LOCK_PTHREAD  0
+#define  LOCK_FUTEX  1
+#define LOCK_SPIN   2
+
+static const char  *const  wakenames[]  =  { "server (futex word + sem)",  "semaphore pair",   "futex pair",  "spin-then-park",   "eventfd pair",  "pipe pair"};
+static const char  *const  locknames[]  =  { "pthread mutex",   "futex mutex",  "spin-then-park"};
+
+typedef  struct {
+    sem_t  sems[2];
+    uint32_t   words[2];
+    uint32_t  parked[2];
+    int  eventfds[2];
+    int   pipes[2][2];
+
+    pthread_mutex_t  mutex;
+    uint32_t   lockword;
+    long  shared[8];
+    LogQueue   logqueue;
+    long  dropped;
+
+    int  stop;
+    long   operations[ MAX_CHILDREN];
+    int  samplecount[ MAX_CHILDREN];
+    uint32_t   samples[ MAX_CHILDREN][ SAMPLES_PER_CHILD];
+}  Arena;
+
+Arena  *arena;
+int  cpucount;
+
+long  nanotime()  {
+    struct timespec  now;
+    clock_gettime( CLOCK_MONOTONIC,   &now);
+    return  now.tv_sec  *  1000000000L  +   now.tv_nsec;
+}
+
+void  pin( int  cpu)  {
+    cpu_set_t  cpuset;
+    CPU_ZERO( &cpuset);
+    CPU_SET( cpu,   &cpuset);
+    sched_setaffinity( 0,  sizeof( cpuset),   &cpuset);
+}
+
+int  compareuint( const void  *a,   const void  *b)  {
+    uint32_t  x  =  *( const uint32_t  *)a,   y  =  *( const uint32_t  *)b;
+    return  ( x  >  y)  -  ( x  <  y);
+}
+
+void  printdistribution( uint32_t  *samples,   int  count,  double  throughput)  {
+    if ( count  ==  0)  {
+        printf( "%10s %10s %10s %10s %14.0f\n",   "-",  "-",   "-",  "-",  throughput);
+        return;
+    }
+    qsort( samples,  count,   sizeof( uint32_t),  compareuint);
+    printf( "%10.2f %10.2f %10.2f %10.2f %14.0f\n",   samples[ count  /  2]  /  1e3,
+            samples[ ( long)count  *  99  /  100]  /  1e3,   samples[ ( long)count  *  999  /  1000]  /  1e3,
+            samples[ count  -  1]  /  1e3,   throughput);
+}
+
+void  futexwake( uint32_t  *word)  {
+    syscall( SYS_futex,  word,   FUTEX_WAKE,  1,   NULL,  NULL,  0);
+}
+
+void  futexwait( uint32_t  *word,   uint32_t  value)  {
+    syscall( SYS_futex,  word,   FUTEX_WAIT,  value,   NULL,  NULL,  0);
+}
+
+void  wakesignal( int  kind,   int  channel)  {
+    uint64_t  one  =  1;
+    char  byte  =  1;
+    switch ( kind)  {
+        case  WAKE_SERVER:
+            if ( channel  ==  1)  {
+                sem_post( &arena->sems[1]);
+                break;
+            }
+            __atomic_add_fetch( &arena->words[0],   1,  __ATOMIC_RELEASE);
+            syscall( SYS_futex,  &arena->words[0],   FUTEX_WAKE_BITSET,  INT_MAX,   NULL,  NULL,  1u);
+            break;
+        case  WAKE_SEMAPHORE:
+            sem_post( &arena->sems[channel]);
+            break;
+        case  WAKE_FUTEX:
+            __atomic_add_fetch( &arena->words[channel],   1,  __ATOMIC_RELEASE);
+            futexwake( &arena->words[channel]);
+            break;
+        case  WAKE_SPIN:
+            __atomic_add_fetch( &arena->words[channel],   1,  __ATOMIC_SEQ_CST);
+            if ( __atomic_load_n( &arena->parked[channel],   __ATOMIC_SEQ_CST))  futexwake( &arena->words[channel]);
+            break;
+        case  WAKE_EVENTFD:
+            if ( write( arena->eventfds[channel],  &one,   sizeof( one))  <  0)  perror( "eventfd write");
+            break;
+        case  WAKE_PIPE:
+            if ( write( arena->pipes[channel][1],   &byte,  1)  <  0)   perror( "pipe write");
+            break;
+    }
+}
+
+void  wakewait( int  kind,   int  channel,  uint32_t  *seen)  {
+    uint64_t  count;
+    char  byte;
+    uint32_t  *word  =  &arena->words[channel];
+    uint32_t  value;
+    switch ( kind)  {
+        case  WAKE_SERVER:
+            if ( channel  ==  1)  {
+                sem_wait( &arena->sems[1]);
+                break;
+            }
+            while ( ( value  =  __atomic_load_n( word,   __ATOMIC_ACQUIRE))  ==  *seen)  {
+                syscall( SYS_futex,  word,   FUTEX_WAIT_BITSET,  value,   NULL,  NULL,  1u);
+            }
+            *seen  =  value;
+            break;
+        case  WAKE_SEMAPHORE:
+            sem_wait( &arena->sems[channel]);
+            break;
+        case  WAKE_FUTEX:
+            while ( ( value  =  __atomic_load_n( word,   __ATOMIC_ACQUIRE))  ==  *seen)  futexwait( word,   value);
+            *seen  =  value;
+            break;
+        case  WAKE_SPIN:
+            for ( int spin  =  0;   spin  <  SPIN_LIMIT;  spin++)  {
+                if ( ( value  =  __atomic_load_n( word,   __ATOMIC_ACQUIRE))  !=  *seen)  {
+                    *seen  =  value;
+                    return;
+                }
+                cpurelax();
+            }
+            __atomic_store_n( &arena->parked[channel],   1,  __ATOMIC_SEQ_CST);
+            while ( ( value  =  __atomic_load_n( word,   __ATOMIC_SEQ_CST))  ==  *seen)  futexwait( word,   value);
+            __atomic_store_n( &arena->parked[channel],   0,  __ATOMIC_RELAXED);
+            *seen  =  value;
+            break;
+        case  WAKE_EVENTFD:
+            if ( read( arena->eventfds[channel],  &count,   sizeof( count))  <  0)  perror( "eventfd read");
+            break;
+        case  WAKE_PIPE:
+            if ( read( arena->pipes[channel][0],   &byte,  1)  <  0)   perror( "pipe read");
+            break;
+    }
+}
+
+void  resetarena()  {
+    pthread_mutexattr_t  mutexattr;
+    pthread_mutexattr_init( &mutexattr);
+    pthread_mutexattr_setpshared( &mutexattr,   PTHREAD_PROCESS_SHARED);
+    pthread_mutex_init( &arena->mutex,   &mutexattr);
+    pthread_mutexattr_destroy( &mutexattr);
+
+    for ( int channel  =  0;   channel  <  2;  channel++)  {
+        sem_init( &arena->sems[channel],   1,  0);
+        arena->words[channel]  =  0;
+        arena->parked[channel]   =  0;
+    }
+    arena->lockword  =  0;
+    memset( arena->shared,  0,   sizeof( arena->shared));
+    memset( &arena->logqueue,   0,  sizeof( LogQueue));
+    arena->dropped  =  0;
+    arena->stop   =  0;
+    memset( arena->operations,  0,   sizeof( arena->operations));
+    memset( arena->samplecount,   0,  sizeof( arena->samplecount));
+}
+
+void  runpingpong( int  kind,   int  cores)  {
+    resetarena();
+    fflush( stdout);
+    pid_t  child  =  fork();
+    if ( child  ==  0)  {
+        pin( cores  >  1  ?  1  :  0);
+        uint32_t  seen  =  0;
+        for ( int round  =  0;   round  <  ROUNDS;  round++)  {
+            wakewait( kind,   0,  &seen);
+            wakesignal( kind,   1);
+        }
+        _exit( 0);
+    }
+
+    pin( 0);
+    uint32_t  seen  =  0;
+    long  start  =  nanotime();
+    for ( int round  =  0;   round  <  ROUNDS;  round++)  {
+        long  before  =  nanotime();
+        wakesignal( kind,   0);
+        wakewait( kind,   1,  &seen);
+        arena->samples[0][ round  %  SAMPLES_PER_CHILD]  =  nanotime()   -  before;
+    }
+    double  seconds  =  ( nanotime()  -  start)  /  1e9;
+    waitpid( child,  NULL,   0);
+
+    printf( "%5d %-26s ",   cores,  wakenames[kind]);
+    printdistribution( arena->samples[0],   SAMPLES_PER_CHILD,  ROUNDS  /  seconds);
+}
+
+void  lock( int  kind)  {
+    if ( kind  ==  LOCK_PTHREAD)  {
+        pthread_mutex_lock( &arena->mutex);
+        return;
+    }
+    uint32_t  *word  =  &arena->lockword;
+    uint32_t  expected;
+    int  spins  =  kind  ==  LOCK_SPIN  ?  SPIN_LIMIT   :  0;
+    for ( int spin  =  0;   spin  <  spins;  spin++)  {
+        expected  =  0;
+        if ( __atomic_compare_exchange_n( word,  &expected,   1,  0,  __ATOMIC_ACQUIRE,   __ATOMIC_RELAXED))  return;
+        cpurelax();
+    }
+    expected  =  0;
+    if ( __atomic_compare_exchange_n( word,  &expected,   1,  0,  __ATOMIC_ACQUIRE,   __ATOMIC_RELAXED))  return;
+    if ( expected  !=  2)  expected  =  __atomic_exchange_n( word,   2,  __ATOMIC_ACQUIRE);
+    while ( expected  !=  0)  {
+        futexwait( word,   2);
+        expected  =  __atomic_exchange_n( word,   2,  __ATOMIC_ACQUIRE);
+    }
+}
+
+void  unlock( int  kind)  {
+    if ( kind  ==  LOCK_PTHREAD)  {
+        pthread_mutex_unlock( &arena->mutex);
+        return;
+    }
+    if ( __atomic_exchange_n( &arena->lockword,   0,  __ATOMIC_RELEASE)  ==  2)  futexwake( &arena->lockword);
+}
+
+void  outsidework()  {
+    for ( volatile int i  =  0;   i  <  OUTSIDE_WORK;  i++);
+}
+
+void  recordsample( int  child,   long  nanoseconds)  {
+    int  count  =  arena->samplecount[child]++;
+    arena->samples[child][ count  %  SAMPLES_PER_CHILD]   =  nanoseconds;
+}
+
+void  contendgame( int  kind,   int  child)  {
+    while ( !__atomic_load_n( &arena->stop,   __ATOMIC_RELAXED))  {
+        long  before  =  nanotime();
+        lock( kind);
+        long  waited  =  nanotime()  -  before;
+        arena->shared[0]++;
+        arena->shared[1]  +=   arena->shared[0]  &  7;
+        arena->shared[2]  =  child;
+        unlock( kind);
+        recordsample( child,   waited);
+        arena->operations[child]++;
+        outsidework();
+    }
+}
+
+void  contendlog( int  kind,   int  child)  {
+    char  message[ LOG_MSG_LEN];
+    snprintf( message,  sizeof( message),   "[2026-01-01 00:00:00] MOVE: Player bot%d placed X at 2,3",   child);
+    while ( !__atomic_load_n( &arena->stop,   __ATOMIC_RELAXED))  {
+        long  before  =  nanotime();
+        lock( kind);
+        LogQueue  *queue  =  &arena->logqueue;
+        int  nexthead  =  ( queue->head  +  1)   %  LOG_QUEUE_SIZE;
+        if ( nexthead  !=  queue->tail)  {
+            strncpy( queue->messages[ queue->head],   message,  LOG_MSG_LEN);
+            queue->targets[ queue->head]  =  LOG_TARGET_GAME;
+            queue->head  =   nexthead;
+            queue->count++;
+        }  else  {
+            arena->dropped++;
+        }
+        unlock( kind);
+        recordsample( child,   nanotime()  -  before);
+        arena->operations[child]++;
+        outsidework();
+    }
+}
+
+void  *loggerthread( void  *arg)  {
+    int  kind  =  ( long)arg;
+    char  batch[ LOG_BATCH][ LOG_MSG_LEN];
+    while ( !__atomic_load_n( &arena->stop,   __ATOMIC_RELAXED))  {
+        int  count  =  0;
+        lock( kind);
+        LogQueue  *queue  =  &arena->logqueue;
+        while ( queue->tail  !=  queue->head  &&   count  <  LOG_BATCH)  {
+            memcpy( batch[count++],   queue->messages[ queue->tail],  LOG_MSG_LEN);
+            queue->tail  =  ( queue->tail  +  1)   %  LOG_QUEUE_SIZE;
+            queue->count--;
+        }
+        unlock( kind);
+        if ( count  ==  0)  usleep( 100);
+    }
+    return  NULL;
+}
+
+void  runcontention( int  kind,   int  children,  int  cores,  int  logging)  {
+    resetarena();
+    fflush( stdout);
+    for ( int child  =  0;   child  <  children;  child++)  {
+        if ( fork()  ==  0)  {
+            pin( child  %  cores);
+            if ( logging)  contendlog( kind,   child);
+            else  contendgame( kind,   child);
+            _exit( 0);
+        }
+    }
+
+    pin( 0);
+    long  start  =  nanotime();
+    if ( logging)  {
+        pthread_t  logger;
+        pthread_create( &logger,  NULL,   loggerthread,  ( void  *)( long)kind);
+        usleep( CONTENTION_NS  /  1000);
+        __atomic_store_n( &arena->stop,  1,   __ATOMIC_RELAXED);
+        pthread_join( logger,  NULL);
+    }  else  {
+        usleep( CONTENTION_NS  /  1000);
+        __atomic_store_n( &arena->stop,  1,   __ATOMIC_RELAXED);
+    }
+    while ( wait( NULL)  >  0);
+    double  seconds  =  ( nanotime()  -  start)  /  1e9;
+
+    long  operations  =  0;
+    int  total  =  0;
+    static uint32_t  merged[ MAX_CHILDREN  *  SAMPLES_PER_CHILD];
+    for ( int child  =  0;   child  <  children;  child++)  {
+        operations  +=  arena->operations[child];
+        int  count  =  arena->samplecount[child]  <  SAMPLES_PER_CHILD  ?  arena->samplecount[child]   :  SAMPLES_PER_CHILD;
+        memcpy( merged  +  total,   arena->samples[child],  count  *  sizeof( uint32_t));
+        total  +=  count;
+    }
+
+    printf( "%5d %8d %-16s ",   cores,  children,   locknames[kind]);
+    if ( logging)  printf( "%7.1f%% ",   operations  ?  100.0  *  arena->dropped  /  operations   :  0.0);
+    printdistribution( merged,  total,   operations  /  seconds);
+}
+
+int  main()  {
+    arena  =  mmap( NULL,   sizeof( Arena),  PROT_READ  |  PROT_WRITE,   MAP_SHARED  |  MAP_ANONYMOUS,  -1,  0);
+    if ( arena  ==  MAP_FAILED)  {
+        perror( "mmap");
+        return  1;
+    }
+    for ( int channel  =  0;   channel  <  2;  channel++)  {
+        arena->eventfds[channel]  =  eventfd( 0,   0);
+        if ( arena->eventfds[channel]  ==  -1  ||  pipe( arena->pipes[channel])   ==  -1)  {
+            perror( "eventfd/pipe");
+            return  1;
+        }
+    }
+
+    cpucount  =  sysconf( _SC_NPROCESSORS_ONLN);
+    if ( cpucount  <  1)  cpucount  =   1;
+    int  cores[ 8],   corecount  =  0;
+    for ( int count  =  1;   count  <  cpucount  &&  corecount  <  7;  count  *=   2)  cores[corecount++]   =  count;
+    cores[corecount++]  =  cpucount;
+
+    const int  childcounts[]  =  { 1,  4,   16,  64};
+    const int  childsizes  =  sizeof( childcounts)   /  sizeof( childcounts[0]);
+
+    printf( "Scheduler <-> child ping-pong (grant, then reply), %d rounds; latency is the round trip\n",   ROUNDS);
+    printf( "%5s %-26s %10s %10s %10s %10s %14s\n",   "cores",  "primitive",   "p50 us",  "p99 us",  "p99.9 us",   "max us",  "round trips/s");
+    for ( int c  =  0;   c  <  corecount;  c++)  {
+        for ( int kind  =  WAKE_SERVER;   kind  <=  WAKE_PIPE;  kind++)  runpingpong( kind,   cores[c]);
+    }
+
+    printf( "\ngamemutex contention: children lock, update shared state, unlock, then work outside; latency is lock acquire\n");
+    printf( "%5s %8s %-16s %10s %10s %10s %10s %14s\n",   "cores",  "children",   "lock",  "p50 us",  "p99 us",   "p99.9 us",  "max us",   "locks/s");
+    for ( int c  =  0;   c  <  corecount;  c++)  {
+        for ( int i  =  0;   i  <  childsizes;  i++)  {
+            for ( int kind  =  LOCK_PTHREAD;   kind  <=  LOCK_SPIN;  kind++)  runcontention( kind,   childcounts[i],  cores[c],   0);
+        }
+    }
+
+    printf( "\nlogmutex enqueue: children fill a %d-slot log queue drained by a logger thread; latency is one enqueue\n",   LOG_QUEUE_SIZE);
+    printf( "%5s %8s %-16s %8s %10s %10s %10s %10s %14s\n",   "cores",  "children",   "lock",  "dropped",   "p50 us",  "p99 us",   "p99.9 us",  "max us",   "enqueues/s");
+    for ( int c  =  0;   c  <  corecount;  c++)  {
+        for ( int i  =  0;   i  <  childsizes;  i++)  {
+            for ( int kind  =  LOCK_PTHREAD;   kind  <=  LOCK_SPIN;  kind++)  runcontention( kind,   childcounts[i],  cores[c],   1);
+        }
+    }
+    return  0;
+}
@@ -0,0 +1,185 @@
+#include "../engine.h"
+
+#define TURNS  20000
+#define  SELECTIONS  2000000
+
+typedef  struct {
+    uint32_t  turnwords[ ( LOBBY_MAX_PLAYERS  +  SEATS_PER_WORD  -  1)   /  SEATS_PER_WORD];
+    int   turnplayer;
+    int  stop;
+    sem_t  schedsem;
+    pthread_mutex_t   mutex;
+    GameState  game;
+    sem_t  turnsem[];
+}  Lobby;
+
+int  usesemaphores;
+
+void  grant( Lobby  *lobby,   int  player)  {
+    if ( usesemaphores)  {
+        if ( player  >=  0)  sem_post( &lobby->turnsem[player]);
+        else  for ( int i  =  0;   i  <  lobby->game.maxplayers;  i++)  sem_post( &lobby->turnsem[i]);
+        return;
+    }
+    __atomic_store_n( &lobby->turnplayer,   player,  __ATOMIC_RELAXED);
+    for ( int word  =  0;   word  *  SEATS_PER_WORD  <  lobby->game.maxplayers;  word++)  {
+        if ( player  >=  0  &&  word  !=  player   /  SEATS_PER_WORD)  continue;
+        uint32_t  mask  =  player  ==  -1  ?  FUTEX_BITSET_MATCH_ANY   :  1u  <<  ( player  %  SEATS_PER_WORD);
+        __atomic_add_fetch( &lobby->turnwords[word],   1,  __ATOMIC_RELEASE);
+        syscall( SYS_futex,  &lobby->turnwords[word],   FUTEX_WAKE_BITSET,  INT_MAX,   NULL,  NULL,  mask);
+    }
+}
+
+void  waitgrant( Lobby  *lobby,   int  player,  uint32_t  *lastseq)  {
+    if ( usesemaphores)  {
+        sem_wait( &lobby->turnsem[player]);
+        return;
+    }
+    uint32_t  *word  =  &lobby->turnwords[ player  /  SEATS_PER_WORD];
+    while ( 1)  {
+        uint32_t  sequence  =  __atomic_load_n( word,   __ATOMIC_ACQUIRE);
+        if ( sequence  !=  *lastseq)  {
+            *lastseq  =  sequence;
+            int  turnplayer  =  __atomic_load_n( &lobby->turnplayer,   __ATOMIC_RELAXED);
+            if ( turnplayer  ==  player  ||  turnplayer   ==  -1)  return;
+            continue;
+        }
+        syscall( SYS_futex,  word,   FUTEX_WAIT_BITSET,  sequence,   NULL,  NULL,  1u  <<  ( player  %   SEATS_PER_WORD));
+    }
+}
+
+void  playerprocess( Lobby  *lobby,   int  player)  {
+    uint32_t  lastseq  =  0;
+    while ( 1)  {
+        waitgrant( lobby,  player,   &lastseq);
+        if ( lobby->stop)  _exit( 0);
+
+        pthread_mutex_lock( &lobby->mutex);
+        int  size  =  lobby->game.boardsize;
+        for ( int cell  =  0;   cell  <  size  *  size;  cell++)  {
+            if ( lobby->game.board[cell]  ==  0)  {
+                engineplay( &lobby->game,   player,  cell  /  size,   cell  %  size);
+                break;
+            }
+        }
+        pthread_mutex_unlock( &lobby->mutex);
+        sem_post( &lobby->schedsem);
+    }
+}
+
+int  linearnextplayer( GameState  *state)  {
+    int  current  =  state->currentturn;
+    for ( int attempts  =  0;   attempts  <  state->playercount;  attempts++)  {
+        if ( state->active[current])  return  current;
+        current  =  ( current  +  1)   %  state->playercount;
+    }
+    return  -1;
+}
+
+int  boardfor( int  players)  {
+    int  size  =  WIN_LEN;
+    while ( size  *  size  <  players  *  4  &&  size   <  LOBBY_MAX_BOARD)  size++;
+    return  size;
+}
+
+double  elapsedsince( struct timespec  *start)  {
+    struct timespec  now;
+    clock_gettime( CLOCK_MONOTONIC,   &now);
+    return  ( now.tv_sec  -  start->tv_sec)   +  ( now.tv_nsec  -  start->tv_nsec)  /  1e9;
+}
+
+double  runturns( int  players,   int  semaphores)  {
+    usesemaphores  =  semaphores;
+    int  size  =  boardfor( players);
+    size_t  header  =  ( sizeof( Lobby)  +  players  *   sizeof( sem_t)  +  7)  &  ~( size_t)7;
+    Lobby  *lobby  =  mmap( NULL,   header  +  enginesize( players,  size),   PROT_READ  |  PROT_WRITE,  MAP_SHARED  |   MAP_ANONYMOUS,  -1,  0);
+    if ( lobby  ==  MAP_FAILED)  {
+        perror( "mmap");
+        exit( 1);
+    }
+
+    pthread_mutexattr_t  mutexattr;
+    pthread_mutexattr_init( &mutexattr);
+    pthread_mutexattr_setpshared( &mutexattr,   PTHREAD_PROCESS_SHARED);
+    pthread_mutex_init( &lobby->mutex,   &mutexattr);
+    sem_init( &lobby->schedsem,  1,   0);
+    for ( int i  =  0;   i  <  players;  i++)  sem_init( &lobby->turnsem[i],   1,  0);
+    engineinit( &lobby->game,   ( char  *)lobby  +  header,  players,   size,  WIN_LEN);
+    for ( int i  =  0;   i  <  players;  i++)  lobby->game.active[i]   =  1;
+    enginestart( &lobby->game,  players);
+
+    fflush( stdout);
+    for ( int i  =  0;   i  <  players;  i++)  {
+        if ( fork()  ==  0)  playerprocess( lobby,   i);
+    }
+
+    struct timespec  start;
+    clock_gettime( CLOCK_MONOTONIC,   &start);
+    for ( int turn  =  0;   turn  <  TURNS;  turn++)  {
+        pthread_mutex_lock( &lobby->mutex);
+        int  current  =  semaphores  ?  linearnextplayer( &lobby->game)   :  enginenextplayer( &lobby->game);
+        pthread_mutex_unlock( &lobby->mutex);
+
+        grant( lobby,   current);
+        sem_wait( &lobby->schedsem);
+
+        pthread_mutex_lock( &lobby->mutex);
+        if ( lobby->game.gameover)  enginestart( &lobby->game,   players);
+        else if ( semaphores)  lobby->game.currentturn  =  ( lobby->game.currentturn   +  1)  %  players;
+        else  engineadvance( &lobby->game);
+        pthread_mutex_unlock( &lobby->mutex);
+    }
+    double  seconds  =  elapsedsince( &start);
+
+    lobby->stop  =  1;
+    grant( lobby,  -1);
+    while ( wait( NULL)  >  0);
+    munmap( lobby,   header  +  enginesize( players,  size));
+    return  seconds  *  1e9  /  TURNS;
+}
+
+double  runselection( int  players,   int  ring)  {
+    void  *memory  =  malloc( enginesize( players,   WIN_LEN));
+    GameState  game;
+    engineinit( &game,   memory,  players,  WIN_LEN,   WIN_LEN);
+    for ( int i  =  0;   i  <  players;  i++)  game.active[i]   =  1;
+    enginestart( &game,  players);
+    for ( int i  =  1;   i  <  players;  i++)  {
+        if ( i  %  10)  enginedrop( &game,   i);
+    }
+
+    volatile int  sink  =  0;
+    struct timespec  start;
+    clock_gettime( CLOCK_MONOTONIC,   &start);
+    for ( int i  =  0;   i  <  SELECTIONS;  i++)  {
+        if ( ring)  {
+            sink  +=  enginenextplayer( &game);
+            engineadvance( &game);
+        }  else  {
+            int  current  =  linearnextplayer( &game);
+            sink  +=  current;
+            game.currentturn  =  ( current  +  1)   %  players;
+        }
+    }
+    double  seconds  =  elapsedsince( &start);
+    free( memory);
+    return  seconds  *  1e9  /  SELECTIONS;
+}
+
+int  main()  {
+    const int  counts[]  =  { 5,  25,   100,  250,  500};
+
+    printf( "Turn cost (scheduler grant -> child move -> schedsem), %d turns per row\n",   TURNS);
+    printf( "%8s %8s %18s %18s %14s %14s\n",   "players",  "board",  "semaphore+scan ns",   "futex+ring ns",  "scan select ns",   "ring select ns");
+    for ( int i  =  0;   i  <  ( int)( sizeof( counts)  /  sizeof( counts[0]));   i++)  {
+        int  players  =  counts[i];
+        double  oldturn  =  runturns( players,   1);
+        double  newturn  =  runturns( players,   0);
+        double  scan  =  runselection( players,   0);
+        double  ring  =  runselection( players,   1);
+        printf( "%8d %5dx%-3d %18.0f %18.0f %14.1f %14.1f\n",   players,  boardfor( players),   boardfor( players),  oldturn,   newturn,  scan,  ring);
+        fflush( stdout);
+    }
+    printf( "Selection columns: next-player pick with 90%% of seats disconnected.\n");
+    return  0;
+}
@@ -0,0 +1,136 @@
+#include "../engine.h"
+
+#define PLAYERS  5
+#define  MOVES  400000
+#define HINTS   20000
+
+static const int  directions[4][2]  =  { { 0,  1},  { 1,   0},  { 1,  1},   { 1,  -1}};
+
+unsigned int  nextrandom( unsigned long long  *state)  {
+    *state  ^=  *state  >>  12;
+    *state  ^=   *state  <<  25;
+    *state  ^=  *state  >>  27;
+    return  ( unsigned int)( ( *state  *  2685821657736338717ULL)   >>  32);
+}
+
+double  elapsedsince( struct timespec  *start)  {
+    struct timespec  now;
+    clock_gettime( CLOCK_MONOTONIC,   &now);
+    return  ( now.tv_sec  -  start->tv_sec)   +  ( now.tv_nsec  -  start->tv_nsec)  /  1e9;
+}
+
+long long  rescancell( const GameState  *state,   int  player,  int  row,   int  col)  {
+    int  size  =  state->boardsize;
+    int  length  =  state->winlength;
+    long long  own  =  0,   opponents  =  0;
+    int  winning  =  0,   blocking  =  0;
+    for ( int d  =  0;   d  <  4;  d++)  {
+        for ( int k  =  0;   k  <  length;  k++)  {
+            int  startrow  =  row  -  k  *  directions[d][0],   startcol  =  col  -  k  *  directions[d][1];
+            int  endrow  =  startrow  +  ( length  -  1)  *   directions[d][0],  endcol  =  startcol  +   ( length  -  1)  *  directions[d][1];
+            if ( startrow  <  0  ||  startcol  <  0  ||   startcol  >=  size  ||  endrow  >=  size  ||   endcol  <  0  ||  endcol  >=  size)  continue;
+            int  owner  =  0,   count  =  0;
+            for ( int i  =  0;   i  <  length  &&  owner  !=  -1;   i++)  {
+                int  mark  =  state->board[ ( startrow  +  i  *  directions[d][0])  *  size   +  startcol  +  i  *  directions[d][1]];
+                if ( !mark)  continue;
+                owner  =  owner  ==  0  ||  owner  ==   mark  ?  mark  :  -1;
+                count++;
+            }
+            if ( owner  <=  0)  continue;
+            long long  weight  =  1LL  <<  ( 5  *   ( count  -  1));
+            if ( owner  ==  player  +  1)  {
+                own  +=  weight;
+                winning  |=  count  ==  length   -  1;
+            }  else  {
+                opponents  +=   weight;
+                blocking  |=  count  ==  length  -   1;
+            }
+        }
+    }
+    return  ( ( long long)( winning  ?  2   :  blocking)  <<  40)  +  ( ( 2  *  own   +  opponents)  <<  8);
+}
+
+int  rescanhint( const GameState  *state,   int  player)  {
+    int  size  =  state->boardsize;
+    int  best  =  -1;
+    long long  bestrating  =  0;
+    for ( int cell  =  0;   cell  <  size  *  size;  cell++)  {
+        if ( state->board[cell])  continue;
+        long long  rating  =  rescancell( state,   player,  cell  /  size,  cell   %  size);
+        if ( best  ==  -1  ||  rating  >   bestrating)  {
+            best  =  cell;
+            bestrating   =  rating;
+        }
+    }
+    return  best;
+}
+
+void  runsize( int  size)  {
+    void  *memory  =  malloc( enginesize( PLAYERS,   size));
+    int  *empty  =  malloc( size  *  size  *   sizeof( int));
+    GameState  game;
+    engineinit( &game,   memory,  PLAYERS,  size,   WIN_LEN);
+    unsigned long long  rng  =  size  *  0x9E3779B97F4A7C15ULL;
+
+    long  moves  =  0,   hints  =  0,  samples  =  0;
+    int  emptycount  =  0;
+    double  playtime  =  0,   hinttime  =  0,  rescantime  =  0,   threattime  =  0;
+    volatile int  sink  =  0;
+    struct timespec  start;
+    while ( moves  <  MOVES)  {
+        if ( emptycount  ==  0  ||  game.gameover)  {
+            for ( int i  =  0;   i  <  PLAYERS;  i++)  game.active[i]   =  1;
+            enginestart( &game,  PLAYERS);
+            emptycount  =  size  *  size;
+            for ( int cell  =  0;   cell  <  emptycount;  cell++)  empty[cell]   =  cell;
+        }
+        int  player  =  enginenextplayer( &game);
+        int  pick  =  nextrandom( &rng)   %  emptycount;
+        int  cell  =  empty[pick];
+        empty[pick]  =  empty[ --emptycount];
+
+        clock_gettime( CLOCK_MONOTONIC,   &start);
+        engineplay( &game,  player,   cell  /  size,  cell  %  size);
+        playtime  +=  elapsedsince( &start);
+        moves++;
+        if ( game.gameover)  continue;
+        engineadvance( &game);
+
+        if ( hints  <  HINTS  &&  moves  %  ( MOVES   /  HINTS)  ==  0)  {
+            int  row,   col,  windows;
+            player  =  enginenextplayer( &game);
+            clock_gettime( CLOCK_MONOTONIC,   &start);
+            sink  +=  enginehint( &game,  player,   &row,  &col);
+            hinttime  +=  elapsedsince( &start);
+
+            clock_gettime( CLOCK_MONOTONIC,   &start);
+            for ( int i  =  0;   i  <  PLAYERS;  i++)  sink  +=   enginethreat( &game,  i,  &windows);
+            threattime  +=  elapsedsince( &start);
+
+            if ( samples  *  size  *  size  <  HINTS  *  36)  {
+                clock_gettime( CLOCK_MONOTONIC,   &start);
+                sink  +=  rescanhint( &game,   player);
+                rescantime  +=  elapsedsince( &start);
+                samples++;
+            }
+            hints++;
+        }
+    }
+    printf( "%5dx%-3d %14.0f %14.0f %14.0f %16.0f\n",   size,  size,   playtime  *  1e9  /  moves,  hinttime   *  1e9  /  hints,
+            threattime  *  1e9  /  hints,   rescantime  *  1e9  /  samples);
+    free( empty);
+    free( memory);
+}
+
+int  main()  {
+    const int  sizes[]  =  { 6,  10,   16,  32,  64};
+
+    printf( "Threat tables, %d players, %d random moves and %d hint/threat queries per board\n",   PLAYERS,  MOVES,   HINTS);
+    printf( "%9s %14s %14s %14s %16s\n",   "board",  "move+update ns",   "HINT ns",  "THREATS ns",   "rescan HINT ns");
+    for ( int i  =  0;   i  <  ( int)( sizeof( sizes)  /  sizeof( sizes[0]));   i++)  {
+        runsize( sizes[i]);
+        fflush( stdout);
+    }
+    printf( "Move cost includes the win check and the threat/window table update; THREATS covers all %d players.\n",   PLAYERS);
+    return  0;
+}
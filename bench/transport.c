@@ -0,0 +1,129 @@
+#include "../transport.h"
+
+#define ROUNDS  20000
+#define  WARMUP  1000
+
+int  comparelatency( const void  *a,   const void  *b)  {
+    double  x  =  *( const double  *)a,   y  =  *( const double  *)b;
+    return  ( x  >  y)  -  ( x  <  y);
+}
+
+int  buildturn( char  *message)  {
+    int  length  =  sprintf( message,  "%s\n",   MSG_YOUR_TURN);
+    for ( int row  =  0;   row  <  BOARD_SIZE;  row++)  {
+        for ( int col  =  0;   col  <  BOARD_SIZE;  col++)  message[length++]   =  ( row  +  col)  %  3  ?  ' '  :   'X';
+        message[length++]  =  '\n';
+    }
+    message[length]  =  '\0';
+    return  length;
+}
+
+int  receiveexactly( Connection  *connection,   char  *buffer,  int  length)  {
+    int  received  =  0;
+    while ( received  <  length)  {
+        ssize_t  count  =  transportrecv( connection,   buffer  +  received,  length  -   received);
+        if ( count  <=  0)  return  -1;
+        received  +=  count;
+    }
+    return  0;
+}
+
+void  serveplayer( int  kind,   int  listenfd,  int  length)  {
+    char  buffer[ BUFFER_SIZE];
+    Connection  connection;
+    int  fd  =  accept( listenfd,   NULL,  NULL);
+    if ( fd  <  0)  _exit( 1);
+    transportattach( &connection,  kind,   fd);
+    if ( kind  ==  TRANSPORT_RING  &&  transportoffer( &connection,   fd)  ==  -1)  _exit( 1);
+
+    for ( int round  =  0;   round  <  WARMUP  +  ROUNDS;  round++)  {
+        if ( receiveexactly( &connection,  buffer,   length)  ==  -1)  break;
+        transportsend( &connection,   "2 3",  3,  0);
+    }
+    transportclose( &connection);
+    _exit( 0);
+}
+
+int  openlistener( int  kind,   int  *port,  char  *path)  {
+    if ( kind  !=  TRANSPORT_TCP)  {
+        transportpath( kind,  *port,   path,  108);
+        return  transportlisten( path,   1);
+    }
+
+    struct sockaddr_in  address;
+    socklen_t  length  =  sizeof( address);
+    memset( &address,  0,   sizeof( address));
+    address.sin_family  =  AF_INET;
+    address.sin_addr.s_addr   =  htonl( INADDR_LOOPBACK);
+    int  fd  =  socket( AF_INET,   SOCK_STREAM,  0);
+    if ( fd  <  0  ||  bind( fd,  ( struct sockaddr  *)&address,   sizeof( address))  <  0  ||  listen( fd,   1)  <  0)  return  -1;
+    getsockname( fd,  ( struct sockaddr  *)&address,   &length);
+    *port  =  ntohs( address.sin_port);
+    return  fd;
+}
+
+void  runtransport( int  kind,   double  *latencies)  {
+    char  message[ BUFFER_SIZE];
+    char  reply[ 4];
+    char  path[ 108]  =  "";
+    int  length  =  buildturn( message);
+    int  port  =  getpid();
+
+    int  listenfd  =  openlistener( kind,   &port,  path);
+    if ( listenfd  <  0)  {
+        perror( transportname( kind));
+        exit( 1);
+    }
+
+    fflush( stdout);
+    pid_t  child  =  fork();
+    if ( child  ==  0)  serveplayer( kind,   listenfd,  length);
+    close( listenfd);
+
+    Connection  connection;
+    if ( transportconnect( &connection,  kind,   "127.0.0.1",  port)  <  0)  {
+        perror( "transportconnect");
+        exit( 1);
+    }
+
+    for ( int round  =  0;   round  <  WARMUP  +  ROUNDS;  round++)  {
+        struct timespec  start,   end;
+        clock_gettime( CLOCK_MONOTONIC,  &start);
+        transportsend( &connection,   message,  length,  0);
+        if ( receiveexactly( &connection,  reply,   3)  ==  -1)  {
+            fprintf( stderr,  "%s: peer closed after %d rounds\n",   transportname( kind),  round);
+            exit( 1);
+        }
+        clock_gettime( CLOCK_MONOTONIC,  &end);
+        if ( round  >=  WARMUP)  {
+            latencies[round  -  WARMUP]  =  ( end.tv_sec  -  start.tv_sec)   *  1e6  +  ( end.tv_nsec  -  start.tv_nsec)  /  1e3;
+        }
+    }
+
+    transportclose( &connection);
+    waitpid( child,  NULL,   0);
+    if ( path[0])  unlink( path);
+}
+
+int  main()  {
+    double  *latencies  =  malloc( ROUNDS  *  sizeof( double));
+    if ( !latencies)  {
+        perror( "malloc");
+        return  1;
+    }
+
+    char  message[ BUFFER_SIZE];
+    printf( "Turn round trip (%d-byte board message -> \"2 3\" reply), %d rounds per transport\n",   buildturn( message),  ROUNDS);
+    printf( "%-6s %10s %10s %10s %10s %10s\n",   "kind",  "mean us",  "p50 us",   "p99 us",  "p99.9 us",   "max us");
+    for ( int kind  =  TRANSPORT_TCP;   kind  <=  TRANSPORT_RING;  kind++)  {
+        runtransport( kind,   latencies);
+        double  total  =  0;
+        for ( int i  =  0;   i  <  ROUNDS;  i++)  total  +=   latencies[i];
+        qsort( latencies,  ROUNDS,   sizeof( double),  comparelatency);
+        printf( "%-6s %10.2f %10.2f %10.2f %10.2f %10.2f\n",   transportname( kind),  total  /  ROUNDS,
+                latencies[ ROUNDS  /  2],   latencies[ ROUNDS  *  99  /  100],  latencies[ ROUNDS  *  999  /  1000],   latencies[ ROUNDS  -  1]);
+        fflush( stdout);
+    }
+    free( latencies);
+    return  0;
+}
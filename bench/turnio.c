@@ -0,0 +1,99 @@
+#include "../common.h"
+#include <sys/resource.h>
+
+#define MOVES  100000
+
+int  syscalls;
+int  coalesced;
+
+ssize_t  countedsend( int  fd,  const void  *data,   size_t  length)  {
+    syscalls++;
+    return  send( fd,   data,  length,  0);
+}
+
+ssize_t  countedread( int  fd,   void  *data,  size_t  length)  {
+    syscalls++;
+    return  read( fd,  data,   length);
+}
+
+int  countlines( const char  *text)  {
+    int  lines  =  0;
+    for ( ;  *text;  text++)  {
+        if ( *text  ==  '\n')   lines++;
+    }
+    return  lines;
+}
+
+void  fillboard( char  *board)  {
+    int  position  =  0;
+    for( int row=0;  row<BOARD_SIZE;   row++)  {
+        for( int col=0;  col<BOARD_SIZE;  col++)   board[position++]  =  ' ';
+        board[position++]  =   '\n';
+    }
+    board[position]  =  '\0';
+}
+
+void  *clientthread( void  *arg)  {
+    int  fd  =  *( int  *)arg;
+    char  buffer[ BUFFER_SIZE];
+    for ( int i  =  0;   i  <  MOVES;  i++)  {
+        int  length  =  countedread( fd,  buffer,   BUFFER_SIZE  -  1);
+        buffer[length]  =  '\0';
+        while ( countlines( buffer)   <  BOARD_SIZE  +  coalesced)  {
+            length  +=  countedread( fd,  buffer  +  length,   BUFFER_SIZE  -  1  -  length);
+            buffer[length]  =   '\0';
+        }
+        countedsend( fd,  "2 3",   3);
+        countedread( fd,  buffer,  strlen( MSG_VALID_MOVE));
+    }
+    return  NULL;
+}
+
+double  cpuseconds()  {
+    struct rusage  usage;
+    getrusage( RUSAGE_SELF,  &usage);
+    return  usage.ru_utime.tv_sec  +  usage.ru_stime.tv_sec   +  ( usage.ru_utime.tv_usec  +  usage.ru_stime.tv_usec)  /  1e6;
+}
+
+void  runpath( int  mode)  {
+    int  fds[2];
+    socketpair( AF_UNIX,  SOCK_STREAM,   0,  fds);
+    coalesced  =  mode;
+    syscalls  =  0;
+
+    char  board[ BUFFER_SIZE];
+    char  message[ BUFFER_SIZE];
+    char  buffer[ BUFFER_SIZE];
+    fillboard( board);
+    int  messagelength  =  snprintf( message,  BUFFER_SIZE,   "%s\n%s",  MSG_YOUR_TURN,  board);
+
+    pthread_t  thread;
+    double  start  =  cpuseconds();
+    pthread_create( &thread,  NULL,   clientthread,  &fds[1]);
+
+    for ( int i  =  0;   i  <  MOVES;  i++)  {
+        if ( coalesced)  {
+            countedsend( fds[0],  message,   messagelength);
+        }  else  {
+            countedsend( fds[0],  MSG_YOUR_TURN,   strlen( MSG_YOUR_TURN));
+            countedsend( fds[0],   board,  strlen( board));
+        }
+        countedread( fds[0],  buffer,   BUFFER_SIZE);
+        countedsend( fds[0],  MSG_VALID_MOVE,   strlen( MSG_VALID_MOVE));
+    }
+
+    pthread_join( thread,  NULL);
+    double  cpu  =  cpuseconds()  -   start;
+    close( fds[0]);
+    close( fds[1]);
+
+    printf( "%-10s syscalls/move %.1f   cpu per 1k moves %.3f ms\n",
+            coalesced  ?  "coalesced"  :  "split",   ( double)syscalls  /  MOVES,  cpu  *  1000.0  /  ( MOVES  /  1000));
+}
+
+int  main()  {
+    printf( "Turn I/O model: %d moves of the split and coalesced send patterns over a socketpair (not the server's playturn; the old pacing sleeps are not modelled)\n",   MOVES);
+    runpath( 0);
+    runpath( 1);
+    return  0;
+}
@@ -1,6 +1,11 @@
-#include "common.h"
+#include "transport.h"
+#include "render.h"
 
-int  sockfd;
+Connection  connection;
+Renderer  renderer;
+int  boardsize  =  BOARD_SIZE;
+int  cellwidth   =  1;
+int  buffersize  =  BUFFER_SIZE;
 
 void  exitwitherror( const char  *message) {
     perror( message);
@@ -37,46 +42,327 @@ void  showcredits()  {
     fflush( stdout );
 }
 
-void  drawboard( char   *boarddata)  {
-    if ( boarddata ==  NULL ||   strlen( boarddata)  == 0)  return;
+int  countlines( const char  *text)  {
+    int  lines  =  0;
+    for ( ;  *text;  text++)  {
+        if ( *text  ==  '\n')   lines++;
+    }
+    return  lines;
+}
 
-    printf( "\n    0   1   2   3   4   5\n");
-    printf( "  +---+---+---+---+---+---+\n");
-    
-    char  *context;
-    char  *line =  strtok_r( boarddata,   "\n",  &context);
-    int  row =  0;
+char  *readturnboard( char  *buffer,   int  length)  {
+    int  offset  =  strstr( buffer,  MSG_YOUR_TURN)  -  buffer  +   strlen( MSG_YOUR_TURN);
+    while ( countlines( buffer  +  offset)  <=  boardsize  &&   length  <  buffersize  -  1)  {
+        int  bytesread  =  transportrecv( &connection,  buffer  +  length,   buffersize  -  1  -  length);
+        if ( bytesread  <=  0)  break;
+        length  +=  bytesread;
+        buffer[length]  =   '\0';
+    }
 
-    while( line != NULL   &&  row < BOARD_SIZE)  {
-        printf( "%d |",  row);
-        
-        int  col =  0;
-        int  length =  strlen( line);
-        for( int x=0;   x<length;  x++) {
-             if ( line[x]  == '|')   continue;
-             
-             printf(  " %c |",  line[x] );
-             col++;
+    char  *board  =  buffer  +  offset;
+    if ( *board  ==  '\n')  board++;
+    return   board;
+}
+
+void  setboard( int  size,   int  width)  {
+    if ( size  <  1  ||  size  >  LOBBY_MAX_BOARD  ||   width  <  1  ||  width  >  4)  return;
+    boardsize  =  size;
+    cellwidth   =  width;
+    buffersize  =  BUFFER_SIZE  +   2  *  boardsize  *  ( boardsize  *  cellwidth  +  1);
+}
+
+void  spectate()  {
+    int  framesize  =  LOBBY_MAX_BOARD  *  ( LOBBY_MAX_BOARD  *  4   +  1);
+    int  capacity  =  BUFFER_SIZE  +   2  *  framesize;
+    char  *buffer  =  malloc( capacity);
+    char  *boardcopy  =  malloc( framesize  +   1);
+    if ( !buffer  ||  !boardcopy)  exitwitherror( "malloc");
+    int  length  =  0;
+
+    printf( "[*] Watching as spectator. Press Ctrl+C to leave.\n");
+    fflush( stdout);
+
+    while ( 1)  {
+        int  bytesread  =  transportrecv( &connection,  buffer  +  length,   capacity  -  1  -  length);
+        if ( bytesread  <=  0)  {
+            printf( "\n[!] Disconnected from server.\n");
+            free( buffer);
+            free( boardcopy);
+            return;
         }
-        
-        while ( col  < BOARD_SIZE)  {
-            printf( "   |");
-            col++;
+        length  +=  bytesread;
+        buffer[length]  =   '\0';
+
+        char  *frame  =  NULL;
+        char  *cursor  =  buffer;
+        char  *update;
+        int  sequence,   size,  width,  skip  =  0;
+        while ( ( update  =  strstr( cursor,  MSG_UPDATE))  !=  NULL  &&
+                sscanf( update,  "UPDATE %d %d %d %n",   &sequence,  &size,   &width,  &skip)  ==  3  &&   countlines( update)  >  size)  {
+            frame  =  update;
+            setboard( size,   width);
+            cursor  =  update  +  strlen( MSG_UPDATE);
+        }
+        if ( !frame)  {
+            if ( length  ==  capacity  -  1)  length  =  0;
+            continue;
+        }
+        sscanf( frame,  "UPDATE %d %d %d %n",   &sequence,  &size,   &width,  &skip);
+
+        char  *board  =  strchr( frame,  '\n')  +  1;
+        char  *end  =  board;
+        for ( int row  =  0;   row  <  boardsize;  row++)  end  =  strchr( end,   '\n')  +  1;
+
+        char  status[ 128];
+        int  statuslength  =  board  -  frame  -  1  -   skip;
+        snprintf( status,  sizeof( status),   "#%d %.*s",  sequence,   statuslength,  frame  +  skip);
+        snprintf( boardcopy,  framesize  +  1,   "%.*s",   ( int)( end  -  board),  board);
+
+        char  banner[ 160];
+        snprintf( banner,  sizeof( banner),   "[SPECTATOR] %s",  status);
+        renderboard( &renderer,   banner,  boardcopy,  boardsize,   cellwidth);
+
+        length  -=  end  -  buffer;
+        memmove( buffer,  end,   length  +  1);
+    }
+}
+
+char  *findheader( char  *buffer,   const char  *keyword)  {
+    size_t  length  =  strlen( keyword);
+    char  *line  =  buffer;
+    while ( *line)  {
+        if ( strncmp( line,  keyword,   length)  ==  0  &&  strchr( " \n",   line[length]))  return  line;
+        int  skip  =  strncmp( line,  MSG_YOUR_TURN,   strlen( MSG_YOUR_TURN))  ==  0  ?  boardsize  +  1   :  1;
+        while ( skip--  >  0  &&  *line)  {
+            char  *next  =  strchr( line,  '\n');
+            line  =  next  ?  next  +  1   :  line  +  strlen( line);
+        }
+    }
+    return  NULL;
+}
+
+int  startgame( char  **buffer,   int  *bytesread,  char  *identifier)  {
+    char  *start  =  findheader( *buffer,  MSG_START);
+    int  size,   width;
+    printf( "[Debug] START buffer received (%d bytes): '%s'\n",   *bytesread,  *buffer);
+    if ( start  &&  sscanf( start,  MSG_START  " %d %d %7s",   &size,  &width,  identifier)   ==  3)  {
+        char  *rest  =  strchr( start,  '\n');
+        rest  =  rest  ?  rest  +  1   :  start  +  strlen( start);
+        *bytesread  -=  rest  -  *buffer;
+        memmove( *buffer,  rest,   *bytesread  +  1);
+        setboard( size,  width);
+        *buffer  =  realloc( *buffer,   buffersize);
+        if ( !*buffer)  exitwitherror( "realloc");
+    }
+    printf( "\n[!] GAME STARTED! You are %s on a %dx%d board.\n",   identifier,  boardsize,  boardsize);
+    if ( findheader( *buffer,   MSG_YOUR_TURN))  {
+        printf( "[Debug] YOUR_TURN was received with START!\n");
+        return  1;
+    }
+    return  0;
+}
+
+const char  *resultbanner( char  *buffer)  {
+    char  *header  =  findheader( buffer,   MSG_GAME_OVER);
+    char  result[ 16];
+    if ( !header  ||  sscanf( header,  MSG_GAME_OVER  " %15s",   result)  !=  1)  return  NULL;
+    if ( strcmp( result,   MSG_WIN)  ==  0)  return  "🏆 VICTORY! You won the game! 🏆";
+    if ( strcmp( result,  MSG_LOSE)  ==  0)  return  "💀 GAME OVER. You lost. 💀";
+    if ( strcmp( result,   MSG_DRAW)  ==  0)  return  "🤝 DRAW GAME. No winner. 🤝";
+    return  NULL;
+}
+
+int  finishgame( char  *buffer,   const char  *banner)  {
+    renderinvalidate( &renderer);
+    clearscreen( );
+    showheader( );
+    printf( "\n\n    %s\n\n",   banner);
+    fflush( stdout);
+
+    char  *prompt;
+    while ( !( prompt  =  strstr( buffer,   MSG_PLAY_AGAIN)))  {
+        memset( buffer,  0,   buffersize);
+        if ( transportrecv( &connection,  buffer,   buffersize  -  1)  <=  0)  {
+            printf( "[!] Disconnected from server.\n");
+            return  0;
         }
+    }
+
+    int  games,   wins,  rating,   deviation;
+    int  fields  =  sscanf( prompt,  MSG_PLAY_AGAIN  " %d %d %d %d",   &games,  &wins,  &rating,   &deviation);
+    if ( fields  >=  2)  {
+        printf( "    Session: %d games played, %d won.\n",   games,  wins);
+    }
+    if ( fields  ==  4)  {
+        printf( "    Rating: %d +/- %d\n",   rating,  2  *  deviation);
+    }
+    printf( "\nPlay again? [Y/n]: ");
+    fflush( stdout);
+
+    char  answer[ 16];
+    int  again  =  fgets( answer,   sizeof( answer),  stdin)  !=  NULL  &&  answer[0]   !=  'n'  &&  answer[0]  !=  'N';
+    const char  *reply  =  again  ?  MSG_AGAIN   :  MSG_LEAVE;
+    transportsend( &connection,  reply,   strlen( reply),  0);
+    if ( !again)  showcredits( );
+    return  again;
+}
+
+int  queuepremove( const char  *line,   int  *premoves)  {
+    char  message[ 128];
+    int  length  =  sprintf( message,   "%s",  MSG_PREMOVE);
+    if ( line[0]  ==  'x'  ||  line[0]   ==  'X')  {
+        length  +=  sprintf( message  +  length,   " %s",  MSG_PREMOVE_CLEAR);
+        *premoves  =  0;
+        printf( "[*] Premoves cleared.\n");
+    }  else  {
+        int  row,   col,  used,   choices  =  0;
+        while ( choices  <  PREMOVE_CHOICES  &&  sscanf( line,   "%d %d%n",  &row,  &col,   &used)  ==  2)  {
+            length  +=  sprintf( message  +  length,   " %d %d",  row,  col);
+            line  +=  used;
+            choices++;
+        }
+        if ( choices  ==  0  ||  *premoves  ==   PREMOVE_QUEUE)  {
+            printf( "[!] Premove: ROW COL [ROW COL ...] (first empty cell is played), or x to clear.\n");
+            return  0;
+        }
+        ( *premoves)++;
+        printf( "[*] Premove %d queued.\n",   *premoves);
+    }
+    message[length++]  =  '\n';
+    fflush( stdout);
+    return  transportsend( &connection,   message,  length,  0);
+}
 
-        printf( "\n  +---+---+---+---+---+---+\n");
+const char  *askserver( const char  *request,   char  *answer,  int  capacity)  {
+    char  message[ 16];
+    int  length  =  snprintf( message,  sizeof( message),   "%s\n",  request);
+    transportsend( &connection,  message,   length,  0);
+
+    memset( answer,  0,   capacity);
+    if ( transportrecv( &connection,  answer,   capacity  -  1)  <=  0)  return  "No answer from server.";
+    answer[ strcspn( answer,  "\n")]   =  '\0';
+
+    int  row,   col;
+    char  *reply  =  strstr( answer,  request);
+    if ( !reply)  return  "No answer from server.";
+    if ( sscanf( reply,  MSG_HINT  " %d %d",   &row,  &col)  ==  2)  {
+        snprintf( answer,  capacity,   "Hint: try %d %d",  row,   col);
+    }  else if ( strncmp( reply,  MSG_HINT,   strlen( MSG_HINT))  ==  0)  {
+        snprintf( answer,  capacity,   "Hint: no empty cell left");
+    }  else if ( reply[ strlen( MSG_THREATS)]  ==  '\0')  {
+        snprintf( answer,  capacity,   "Threats: nobody has an open line yet");
+    }  else  {
+        char  threats[ BUFFER_SIZE];
+        snprintf( threats,  sizeof( threats),   "%s",  reply  +  strlen( MSG_THREATS));
+        snprintf( answer,  capacity,   "Threats (symbol:longest:lines):%s",  threats);
+    }
+    return  answer;
+}
+
+int  waitserver( char  *buffer,   int  *premoves)  {
+    static int  inputclosed  =  0;
+    while ( 1)  {
+        struct pollfd  pollfds[3]  =  { { inputclosed  ?  -1  :  STDIN_FILENO,   POLLIN,  0},
+                                     { transportreadfd( &connection),  POLLIN,   0},  { connection.fd,  POLLIN,   0}};
+        if ( poll( pollfds,  3,   -1)  <  0)  {
+            if ( errno  ==  EINTR)  continue;
+            return  -1;
+        }
+        if ( pollfds[1].revents  ||  pollfds[2].revents)  {
+            memset( buffer,  0,   buffersize);
+            return  transportrecv( &connection,   buffer,  buffersize  -  1);
+        }
+
+        char  line[ 64];
+        if ( fgets( line,  sizeof( line),   stdin)  ==  NULL)  inputclosed  =  1;
+        else  queuepremove( line,   premoves);
+    }
+}
+
+int  waitprompt()  {
+    struct pollfd  pollfds[3]  =  { { STDIN_FILENO,   POLLIN,  0},
+                                 { transportreadfd( &connection),  POLLIN,   0},  { connection.fd,  POLLIN,   0}};
+    while ( poll( pollfds,  3,   -1)  <  0)  {
+        if ( errno  !=  EINTR)  return  0;
+    }
+    return  pollfds[1].revents  ||  pollfds[2].revents;
+}
+
+int  joinserver( int  kind,   const char  *ipaddress,  int  port,   char  *buffer)  {
+    int  backoff  =  RETRY_BASE_MS;
+    char  host[ 64];
+    int  hostport  =  port;
+    int  redirects  =   0;
+    snprintf( host,  sizeof( host),   "%s",  ipaddress);
+    for ( int attempt  =  1;   ;  attempt++)  {
+        if ( transportconnect( &connection,  kind,   host,  hostport)  <  0)  {
+            exitwitherror( "Connection Failed. Is the server running?");
+        }
+        printf( "[*] Connected!\n");
+        transportsend( &connection,  MSG_JOIN  "\n",   strlen( MSG_JOIN)  +  1,  0);
+
+        memset( buffer,   0,  buffersize);
+        int  bytesread  =  transportrecv( &connection,  buffer,   buffersize  -  1);
+        if ( bytesread  >  0  &&  strncmp( buffer,   MSG_REDIRECT  " ",  strlen( MSG_REDIRECT)  +  1)  ==   0)  {
+            transportclose( &connection);
+            if ( ++redirects  >  FEDERATION_MAX_REDIRECTS   ||  sscanf( buffer,  MSG_REDIRECT  " %63s %d",   host,  &hostport)  !=  2)  {
+                exitwitherror( "Coordinator redirect loop");
+            }
+            printf( "[*] Redirected to %s:%d.\n",   host,  hostport);
+            attempt--;
+            continue;
+        }
+        if ( bytesread  <=  0  ||  strncmp( buffer,   MSG_BUSY,  strlen( MSG_BUSY))  !=  0)  return  bytesread;
+        transportclose( &connection);
+        snprintf( host,  sizeof( host),   "%s",  ipaddress);
+        hostport  =  port;
+        redirects   =  0;
+
+        char  reason[ 32]  =  "?";
+        int  retryms  =   0;
+        sscanf( buffer,  MSG_BUSY  " %31s %d",   reason,  &retryms);
+        if ( attempt  ==  RETRY_ATTEMPTS)  {
+            printf( "[!] Server busy (%s). Giving up after %d attempts.\n",   reason,  attempt);
+            exit( EXIT_FAILURE);
+        }
+
+        int  delay  =  retryms  >  backoff  ?  retryms   :  backoff;
+        delay  +=  rand()  %  ( delay  /  2  +   1);
+        printf( "[*] Server busy (%s). Retrying in %.1f s (attempt %d/%d)...\n",   reason,  delay  /  1000.0,   attempt,  RETRY_ATTEMPTS);
         fflush( stdout);
-        row++;
-        line =  strtok_r( NULL,   "\n",  &context);
+        struct timespec  pause  =  { delay  /  1000,   ( delay  %  1000)  *  1000000L};
+        while ( nanosleep( &pause,  &pause)  ==  -1   &&  errno  ==  EINTR);
+        backoff  =  backoff  *  2  >  RETRY_MAX_MS  ?  RETRY_MAX_MS   :  backoff  *  2;
     }
 }
 
 int main( int argc,   char  *argv[])  {
-    struct sockaddr_in  serveraddr;
-    char  buffer[ BUFFER_SIZE];
+    char  *buffer  =  malloc( buffersize);
+    char  identifier[ 8]  =  "?";
     int  introshown   =  0;
+    int  spectator  =  0;
+    int  port  =  -1;
+    int  kind  =  TRANSPORT_TCP;
+
+    int  option;
+    while ( ( option  =  getopt( argc,  argv,   "wp:t:"))  !=  -1)  {
+        switch ( option)  {
+            case  'w':  spectator  =  1;   break;
+            case  'p':  port  =   atoi( optarg);  break;
+            case  't':  kind  =  transportkind( optarg);   break;
+            default:
+                fprintf( stderr,  "Usage: %s [-w] [-p port] [-t tcp|unix|ring] [SERVER_IP]\n",   argv[0]);
+                exit( EXIT_FAILURE);
+        }
+    }
+    if ( kind  ==  -1  ||  ( spectator  &&  kind  !=  TRANSPORT_TCP))  {
+        fprintf( stderr,  "Transport must be tcp, unix or ring; spectators use tcp.\n");
+        exit( EXIT_FAILURE);
+    }
+    if ( port  ==  -1)  port  =  spectator  ?  PORT  +  SPECTATOR_PORT_OFFSET  :   PORT;
 
     
+    renderinit( &renderer);
     int  showatstart =  1;
     if ( showatstart  &&   !introshown)  {
         clearscreen( );
@@ -85,27 +371,21 @@ int main( int argc,   char  *argv[])  {
     }
 
 
-    if ( ( sockfd  = socket( AF_INET,  SOCK_STREAM,  0))   <  0)  {
-        exitwitherror( "Socket creation error");
-    }
-
-    serveraddr.sin_family  =  AF_INET;
-    serveraddr.sin_port =  htons( PORT);
-    
-    const  char   *ipaddress =  ( argc  > 1) ?  argv[1]  :  "127.0.0.1";
-    if (  inet_pton( AF_INET,  ipaddress,  &serveraddr.sin_addr)  <=  0) {
-        exitwitherror( "Invalid address / Address not supported");
-    }
-
-    printf( "[*] Connecting to server at %s...\n",   ipaddress);
-    if ( connect( sockfd,  ( struct sockaddr*)&serveraddr,   sizeof( serveraddr))  <  0)  {
-        exitwitherror( "Connection Failed. Is the server running?");
+    const  char   *ipaddress =  ( optind  < argc) ?  argv[optind]  :  "127.0.0.1";
+    printf( "[*] Connecting to server at %s over %s...\n",   ipaddress,  transportname( kind));
+    if ( spectator)  {
+        if ( transportconnect( &connection,  kind,   ipaddress,  port)  <  0)  {
+            exitwitherror( "Connection Failed. Is the server running?");
+        }
+        printf( "[*] Connected!\n");
+        spectate();
+        transportclose( &connection);
+        return  0;
     }
-    printf( "[*] Connected!\n");
 
+    srand( time( NULL)  ^  getpid());
     printf( "[Debug] Waiting for WELCOME from server...\n");
-    memset( buffer,   0,  BUFFER_SIZE);
-    int  bytesread  =  read( sockfd,  buffer,   BUFFER_SIZE);
+    int  bytesread  =  joinserver( kind,   ipaddress,  port,  buffer);
     if ( bytesread  <  0)  perror( "[Debug] Read failed");
     else  printf( "[Debug] Received %d bytes: %s\n",   bytesread,  buffer);
     
@@ -118,7 +398,7 @@ int main( int argc,   char  *argv[])  {
         printf( "\nENTER YOUR NAME: ");
         fflush( stdout);
         
-        if ( fgets( buffer,   sizeof( buffer),  stdin)  !=  NULL)  {
+        if ( fgets( buffer,   buffersize,  stdin)  !=  NULL)  {
             buffer[ strcspn( buffer,  "\n")]  =  0;
             strncpy( playername,  buffer,   31);
             playername[31]  =  '\0';
@@ -126,24 +406,18 @@ int main( int argc,   char  *argv[])  {
             strcpy( playername,   "Guest");
         }
         
-        send( sockfd,  playername,   strlen( playername),  0);
+        transportsend( &connection,  playername,   strlen( playername),  0);
     }
 
     printf( "\n[*] Waiting for other players to join...\n");
     
-    memset( buffer,  0,   BUFFER_SIZE);
-    bytesread   =  read( sockfd,  buffer,  BUFFER_SIZE);
+    memset( buffer,  0,   buffersize);
+    bytesread   =  transportrecv( &connection,  buffer,  buffersize  -  1);
     int  gotturn  =  0;
-    if ( bytesread   >  0)  {
-        printf( "\n[!] GAME STARTED!\n");
-        printf( "[Debug] START buffer received (%d bytes): '%s'\n",   bytesread,  buffer);
-        if ( strstr( buffer,   MSG_YOUR_TURN))  {
-            gotturn  =  1;
-            printf( "[Debug] YOUR_TURN was received with START!\n");
-        }
-    }
+    if ( bytesread   >  0)  gotturn  =  startgame( &buffer,   &bytesread,  identifier);
 
     int  waitingshown   =  0;
+    int  premoves  =  0;
 
     while ( 1)  {
         int  readcount  =  0;
@@ -151,16 +425,15 @@ int main( int argc,   char  *argv[])  {
         if   ( gotturn)  {
             gotturn  =  0;
             waitingshown   =  0;
-            readcount  =  1;
-            strcpy( buffer,   MSG_YOUR_TURN);
+            readcount  =  bytesread;
         }  else   {
             if ( !waitingshown)  {
-                printf( "\n[*] Waiting for turn/update...\n");
+                printf( "\n[*] Waiting for turn/update... Queue premoves with ROW COL [ROW COL ...], x clears.\n");
+                fflush( stdout);
                 waitingshown  =   1;
             }
 
-            memset( buffer,  0,  BUFFER_SIZE);
-            readcount  =  read( sockfd,   buffer,  BUFFER_SIZE);
+            readcount  =  waitserver( buffer,   &premoves);
         }
         
         if ( readcount  <=   0)  {
@@ -168,106 +441,103 @@ int main( int argc,   char  *argv[])  {
             return  0;
         }
 
-        if ( strstr( buffer,   MSG_WIN))  {
-            clearscreen( );
-            showheader( );
-            printf( "\n\n    🏆 VICTORY! You won the game! 🏆\n\n");
+        for ( char  *premoved  =  buffer;   ( premoved  =  strstr( premoved,  MSG_PREMOVED))  !=  NULL;   premoved++)  {
+            int  row,   col;
+            if ( sscanf( premoved,  MSG_PREMOVED  " %d %d",   &row,  &col)  !=  2)  continue;
+            if ( premoves  >  0)  premoves--;
+            printf( "[*] Premove played at %d,%d (%d queued).\n",   row,  col,  premoves);
             fflush( stdout);
-            sleep( 10);
-            showcredits( );
-            return   0;
         }
-        else if ( strstr( buffer,  MSG_LOSE))  {
-            clearscreen( );
-            showheader( );
-            printf( "\n\n    💀 GAME OVER. You lost. 💀\n\n");
-            fflush( stdout);
-            sleep( 10);
-            showcredits( );
-            return  0;
+
+        const char  *banner  =  resultbanner( buffer);
+        if ( banner)  {
+            premoves  =  0;
+            if ( !finishgame( buffer,  banner))  {
+                transportclose( &connection);
+                return  0;
+            }
+            printf( "\n[*] Waiting for the next game...\n");
+            waitingshown  =  1;
         }
-        else  if  ( strstr( buffer,  MSG_DRAW))  {
-            clearscreen( );
-            showheader( );
-            printf( "\n\n    🤝 DRAW GAME. No winner. 🤝\n\n");
-            fflush( stdout);
-            sleep( 10);
-            showcredits( );
-            return  0;
+        else if ( findheader( buffer,   MSG_START))  {
+            premoves  =  0;
+            gotturn  =  startgame( &buffer,   &readcount,  identifier);
+            bytesread  =  readcount;
         }
         else if ( strstr( buffer,   MSG_YOUR_TURN))  {
             waitingshown  =  0;
-            clearscreen( );
-            showheader( );
-            printf( "\n👉 YOUR TURN!\n");
-            
-            memset( buffer,  0,   BUFFER_SIZE);
-            read( sockfd,   buffer,  BUFFER_SIZE);
-            
-            drawboard( buffer);
+            if ( premoves  >  0)  premoves--;
+            char  status[ 64];
+            snprintf( status,  sizeof( status),   "👉 YOUR TURN! (you are %s)",  identifier);
+            renderboard( &renderer,   status,  readturnboard( buffer,  readcount),   boardsize,  cellwidth);
 
             int  row,   col;
             char  inputline[ 64];
+            char  answer[ BUFFER_SIZE];
+            const char  *notice  =  "";
+            int  finished  =  0;
             
             while( 1)  {
-                printf( "\nEnter Move (Row Column): ");
-                fflush( stdout);
+                renderprompt( &renderer,   notice,  "Enter Move (Row Column, h = hint, t = threats): ");
+                notice  =  "";
                 
-                if ( fgets( inputline,   sizeof( inputline),  stdin)  ==  NULL)  {
-                    continue;
+                if ( !waitprompt( ))  {
+                    if ( fgets( inputline,   sizeof( inputline),  stdin)  ==  NULL)  {
+                        continue;
+                    }
+                    if ( renderscroll( &renderer,   inputline))  continue;
+                    if ( inputline[0]  ==  'h'  ||  inputline[0]   ==  't')  {
+                        notice  =  askserver( inputline[0]  ==  'h'  ?  MSG_HINT   :  MSG_THREATS,  answer,   sizeof( answer));
+                        continue;
+                    }
+
+                    if ( sscanf( inputline,  "%d %d",   &row,  &col)  !=  2)  {
+                        notice  =  "Invalid input. Use format: ROW COL (e.g., 2 3)";
+                        continue;
+                    }
+
+                    char   movestring[ 32];
+                    sprintf( movestring,   "%d %d",  row,  col);
+                    transportsend( &connection,  movestring,  strlen( movestring),  0);
                 }
-                
-                if ( sscanf( inputline,  "%d %d",   &row,  &col)  !=  2)  {
-                    printf( "Invalid input. Use format: ROW COL (e.g., 2 3)\n");
-                    continue;
+
+                memset( buffer,  0,   buffersize);
+                if ( transportrecv( &connection,  buffer,   buffersize  -  1)  <=  0)  {
+                    printf( "\n[!] Disconnected from server.\n");
+                    return  0;
+                }
+                if ( findheader( buffer,  MSG_PREMOVE_DROPPED))  {
+                    if ( premoves  >  0)  premoves--;
+                    notice  =  "Premove dropped - its cells are taken. Enter a move.";
                 }
-                
-                char   movestring[ 32];
-                sprintf( movestring,   "%d %d",  row,  col);
-                send( sockfd,  movestring,  strlen( movestring),   0);
-                
-                memset( buffer,  0,   BUFFER_SIZE);
-                read( sockfd,  buffer,   BUFFER_SIZE);
                 if ( strstr( buffer,   MSG_INVALID_MOVE))  {
-                     printf( "Invalid move! Try again.\n");
-                }  else if ( strstr( buffer,  MSG_VALID_MOVE))  {
+                     notice  =  "Invalid move! Try again.";
+                }  else if ( strstr( buffer,  MSG_VALID_MOVE)  ||  strstr( buffer,   MSG_PREMOVED))  {
                      printf( "Valid move!\n");
                      
-                     if ( strstr( buffer,   MSG_WIN))  {
-                         clearscreen( );
-                         showheader( );
-                         printf( "\n\n    🏆 VICTORY! You won the game! 🏆\n\n");
-                         fflush(  stdout);
-                         sleep( 10);
-                         showcredits( );
-                         close( sockfd);
-                         return  0;
-                     } 
-                     else  if   ( strstr( buffer,  MSG_DRAW))  {
-                         clearscreen( );
-                         showheader( );
-                         printf( "\n\n    🤝 DRAW GAME. No winner. 🤝\n\n");
-                         fflush( stdout);
-                         sleep( 10);
-                         showcredits( );
-                         close(  sockfd);
-                         return  0;
+                     banner  =  resultbanner( buffer);
+                     if ( banner)  {
+                         if ( !finishgame( buffer,  banner))  {
+                             transportclose( &connection);
+                             return  0;
+                         }
+                         finished  =  1;
                      }
                      
                      break; 
-                }  else  {
+                }  else if ( !*notice)  {
                      printf( "Unknown response: %s\n",   buffer);
                 }
             }
             
-            printf( "Waiting for other players...\n");
+            printf( finished  ?  "\n[*] Waiting for the next game...\n"  :   "Waiting for other players...\n");
         }
         else if ( strstr( buffer,  "PING"))  {
             continue;
         }
     }
 
-    close( sockfd);
+    transportclose( &connection);
     printf( "\nGame Closed. Scores have been saved on server.\n");
     return   0;
 }
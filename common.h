@@ -1,6 +1,10 @@
 #ifndef COMMON_H
 #define  COMMON_H
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <stdio.h>
 #include  <stdlib.h>
 #include <string.h>
@@ -18,19 +22,85 @@
 #include <errno.h>
 #include  <semaphore.h>
 #include <time.h>
+#include  <poll.h>
+#include <sched.h>
+#include  <sys/file.h>
+#include <sys/resource.h>
+#include  <sys/eventfd.h>
+#include <stdint.h>
+#include  <limits.h>
+#include <sys/syscall.h>
+#include  <linux/futex.h>
+#include <netinet/tcp.h>
 
 #define PORT  8888
 #define MAX_PLAYERS  5
 #define  MIN_PLAYERS  3
 #define BOARD_SIZE  6
 #define WIN_LEN  4
+#define  LOBBY_MAX_PLAYERS   1000
+#define LOBBY_MAX_BOARD  64
+#define  SEATS_PER_WORD  32
 #define  SHM_NAME "/game_shm_v3"
 #define LOG_QUEUE_SIZE   100
 #define  LOG_MSG_LEN 256
+#define LOG_BATCH  32
+#define  LOG_ROTATE_BYTES  ( 10  *  1024  *  1024)
+#define LOG_ROTATE_SECS   ( 24  *  60  *  60)
+#define  LOG_TARGET_GAME  0
+#define LOG_TARGET_ERROR   1
 #define BUFFER_SIZE  1024
+#define  SPECTATOR_PORT_OFFSET  1
+#define SPECTATOR_MAX   1024
+#define  SPECTATOR_QUEUE 16
+#define SPECTATOR_HIGH_WATER  4
+#define  SPECTATOR_LOW_WATER   1
+#define OUTPUT_QUEUE_SIZE  65536
+#define  OUTPUT_HIGH_WATER  32768
+#define OUTPUT_LOW_WATER   8192
+#define  SLOW_PLAYER_DEADLINE  10
+#define REMATCH_DEADLINE  15
+#define  REMATCH_LOBBY_WAIT   1
+#define TRANSPORT_TCP  0
+#define  TRANSPORT_UNIX   1
+#define TRANSPORT_RING  2
+#define  UNIX_PATH_FORMAT  "/tmp/mttt_%d.sock"
+#define RING_PATH_FORMAT   "/tmp/mttt_%d.ring"
+#define  RING_SIZE  65536
+#define RING_SPIN   200
+#define ADMISSION_BACKLOG  1024
+#define  ADMISSION_BATCH   64
+#define ADMISSION_RATE  50
+#define  ADMISSION_DEFER_SECS  5
+#define ADMISSION_JOIN_DEADLINE   10
+#define  ADMISSION_RETRY_FULL_MS  5000
+#define RETRY_BASE_MS  250
+#define  RETRY_MAX_MS   30000
+#define RETRY_ATTEMPTS  10
+#define  COORDINATOR_PORT  8800
+#define FEDERATION_HEARTBEAT  1
+#define  FEDERATION_POLL_MS   250
+#define FEDERATION_TIMEOUT  3
+#define  FEDERATION_MAX_PEERS  1024
+#define FEDERATION_MAX_REDIRECTS   3
+#define  FEDERATION_SCORES_FILE  "federation.txt"
+#define FEDERATION_MAX_PENDING   100
+#define PREMOVE_QUEUE  8
+#define  PREMOVE_CHOICES   4
+#define HISTORY_FILE  "history.dat"
+#define  HISTORY_INDEX_FILE "history.idx"
+#define HISTORY_INDEX_SLOTS   65536
 
+#define  MSG_JOIN  "JOIN"
+#define MSG_BUSY   "BUSY"
+#define  MSG_REDIRECT  "REDIRECT"
+#define MSG_REGISTER   "REGISTER"
+#define  MSG_LOAD  "LOAD"
+#define MSG_SCORE   "SCORE"
+#define  MSG_WON  "WON"
 #define MSG_WELCOME  "WELCOME"
 #define  MSG_WAIT "WAIT"
+#define MSG_START  "START"
 #define MSG_YOUR_TURN   "YOUR_TURN"
 #define MSG_VALID_MOVE  "VALID"
 #define  MSG_INVALID_MOVE "INVALID"
@@ -39,41 +109,197 @@
 #define  MSG_LOSE   "LOSE"
 #define MSG_DRAW  "DRAW"
 #define MSG_GAME_OVER  "GAME_OVER"
+#define  MSG_PLAY_AGAIN  "PLAY_AGAIN"
+#define MSG_AGAIN   "AGAIN"
+#define  MSG_LEAVE  "LEAVE"
+#define MSG_PREMOVE   "PREMOVE"
+#define  MSG_PREMOVED  "PREMOVED"
+#define MSG_PREMOVE_DROPPED  "PREMOVE_DROPPED"
+#define MSG_HINT   "HINT"
+#define  MSG_THREATS  "THREATS"
+#define MSG_PREMOVE_CLEAR  "CLEAR"
+
+#define TURN_PLAYED  0
+#define  TURN_WON  1
+#define TURN_DISCONNECTED   2
 
 typedef  struct {
     int  id;
     int   pid;
-    int  active;
     char  name[32];
-    char symbol;
     int  score;
+    int   games;
+    int  wins;
+    int  joinedgame;
+    int   answeredgame;
 }   Player;
 
+typedef struct  {
+    uint16_t  *board;
+    uint16_t   *windows;
+    uint8_t  *windowcounts;
+    uint32_t   *threats;
+    uint32_t  *threattotal;
+    uint16_t  *hotcounts;
+    int   *hotnext;
+    int  *hotprev;
+    int   *levels;
+    int   *active;
+    int  *next;
+    int  *previous;
+    int   maxplayers;
+    int  boardsize;
+    int  winlength;
+    int   cellwidth;
+    int  playercount;
+    int  activecount;
+    int   currentturn;
+    int  movecount;
+    int   livewindows;
+    int  hothead;
+    int  gameover;
+    int   winner;
+    int  running;
+}  GameState;
+
 typedef struct  {
     char  messages[LOG_QUEUE_SIZE][LOG_MSG_LEN];
+    char  targets[LOG_QUEUE_SIZE];
     int  head;
     int   tail;
     int count;
 }  LogQueue;
 
+typedef struct  {
+    const char  *path;
+    int  fd;
+    off_t   size;
+    time_t  opened;
+    time_t   checked;
+}  LogFile;
+
 typedef  struct   {
     char  name[32];
     int  wins;
 }  ScoreRecord;
 
 typedef  struct {
-    char  board[BOARD_SIZE][BOARD_SIZE];
-    Player   players[MAX_PLAYERS];
+    int  game;
+    int   previous;
+    long long  finished;
+    int  moves;
+    int   duration;
     int  playercount;
+    char  result;
+    char  name[32];
+}  HistoryRecord;
+
+typedef struct  {
+    char  name[32];
+    int   lastrow;
+    int  games;
+}  HistorySlot;
+
+typedef  struct {
+    int  rows;
+    int  slotcount;
+    int   used;
+    HistorySlot   slots[];
+}  HistoryIndex;
+
+static inline  size_t  historyindexsize( int  slots)  {
+    return  sizeof( HistoryIndex)  +   ( size_t)slots  *  sizeof( HistorySlot);
+}
+
+static inline void  cpurelax()  {
+#if defined( __x86_64__)  ||  defined( __i386__)
+    __builtin_ia32_pause();
+#elif defined( __aarch64__)  ||  defined( __arm__)
+    __asm__  __volatile__( "yield"  :::  "memory");
+#else
+    __atomic_signal_fence( __ATOMIC_SEQ_CST);
+#endif
+}
+
+static inline  unsigned int  historyhash( const char  *name)  {
+    unsigned int  hash  =  2166136261u;
+    for ( ;  *name;   name++)  {
+        hash  =  ( hash  ^  ( unsigned char)*name)   *  16777619u;
+    }
+    return  hash;
+}
+
+typedef  struct {
+    int  refcount;
+    int   length;
+    char  data[];
+}  SharedBuffer;
+
+typedef struct  {
+    int  fd;
+    SharedBuffer  *queue[SPECTATOR_QUEUE];
+    int   head;
+    int  count;
+    int  offset;
+    int   congested;
+}  Spectator;
+
+typedef  struct {
+    uint32_t  head;
+    char   headpad[60];
+    uint32_t  tail;
+    char  tailpad[60];
+    uint32_t   readerwaiting;
+    uint32_t  writerwaiting;
+    char  data[RING_SIZE];
+}  Ring;
+
+typedef struct  {
+    int  kind;
+    int   fd;
+    int  wakefd;
+    int   peerwakefd;
+    Ring  *in;
+    Ring   *out;
+}  Connection;
+
+typedef  struct {
+    Connection  *connection;
+    char  data[OUTPUT_QUEUE_SIZE];
+    int   length;
+    int  congested;
+    time_t  congestedsince;
+}  OutputQueue;
+
+typedef struct  {
+    int  count;
+    int   rows[PREMOVE_CHOICES];
+    int  cols[PREMOVE_CHOICES];
+}  Premove;
+
+typedef struct  {
+    int  pid;
+    int   openseats;
+    int  handoff[2];
+}  ShardInfo;
+
+typedef  struct {
+    GameState  game;
+    Player   *players;
     int  connected;
     int   started;
-    int  gameover;
-    int  currentturn;
-    int   winner;
+    time_t   starttime;
+    int  updateseq;
+    int   gamenumber;
+    long  queuedbytes;
+    int   forceddisconnects;
+    int  coalescedupdates;
+    int   droppedupdates;
 
     pthread_mutex_t   gamemutex;
     pthread_mutex_t  logmutex;
-    sem_t  turnsem[MAX_PLAYERS];
+    uint32_t  *turnwords;
+    int   turnplayer;
     sem_t  schedsem;
     
     LogQueue  logqueue;
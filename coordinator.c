@@ -0,0 +1,322 @@
+#include "common.h"
+
+#define COORDINATOR_MAX_SCORES  4096
+#define  COORDINATOR_SAVE_SECS  2
+
+typedef  struct {
+    int  fd;
+    int   node;
+    char  host[ 64];
+    int  port;
+    int   seats;
+    int  openseats;
+    int   connected;
+    time_t  lastseen;
+    char  input[ BUFFER_SIZE];
+    int   length;
+}  Peer;
+
+Peer  peers[ FEDERATION_MAX_PEERS];
+int  peercount;
+ScoreRecord  scores[ COORDINATOR_MAX_SCORES];
+int  scorecount;
+int  scoresdirty;
+const char  *scorefile  =  FEDERATION_SCORES_FILE;
+long  redirects;
+long   refusals;
+
+void  loadfederationscores()  {
+    FILE  *file  =  fopen( scorefile,   "r");
+    if ( !file)  return;
+    char  name[ 32];
+    int  wins;
+    while ( scorecount  <  COORDINATOR_MAX_SCORES  &&  fscanf( file,   "%31s %d",  name,   &wins)  ==  2)  {
+        strncpy( scores[ scorecount].name,  name,   31);
+        scores[ scorecount].wins  =   wins;
+        scorecount++;
+    }
+    fclose( file);
+    printf( "[Coordinator] Loaded %d scores from %s.\n",   scorecount,  scorefile);
+}
+
+void  savefederationscores()  {
+    char  temppath[ 256];
+    snprintf( temppath,  sizeof( temppath),   "%s.tmp",  scorefile);
+    FILE  *file  =  fopen( temppath,   "w");
+    if ( !file)  {
+        perror( "[Coordinator] Cannot write scores");
+        return;
+    }
+    for ( int i  =  0;   i  <  scorecount;  i++)  {
+        fprintf( file,  "%s %d\n",   scores[i].name,  scores[i].wins);
+    }
+    if ( fclose( file)  ==  0)  rename( temppath,   scorefile);
+    scoresdirty  =  0;
+}
+
+void  sendpeer( Peer  *peer,   const char  *data,  int  length)  {
+    if ( peer->fd  ==  -1)  return;
+    if ( send( peer->fd,  data,   length,  MSG_NOSIGNAL  |  MSG_DONTWAIT)  !=  length)  {
+        printf( "[Coordinator] Node %s:%d is not keeping up, dropping it.\n",   peer->host,  peer->port);
+        close( peer->fd);
+        peer->fd  =  -1;
+    }
+}
+
+void  broadcastscore( ScoreRecord  *score)  {
+    char  line[ 64];
+    int  length  =  snprintf( line,  sizeof( line),   "%s %s %d\n",  MSG_SCORE,   score->name,  score->wins);
+    for ( int i  =  0;   i  <  peercount;  i++)  {
+        if ( peers[i].node)  sendpeer( &peers[i],   line,  length);
+    }
+}
+
+ScoreRecord  *findscore( const char  *name)  {
+    for ( int i  =  0;   i  <  scorecount;  i++)  {
+        if ( strcmp( scores[i].name,   name)  ==  0)  return  &scores[i];
+    }
+    if ( scorecount  >=  COORDINATOR_MAX_SCORES)  return  NULL;
+    ScoreRecord  *score  =  &scores[ scorecount++];
+    memset( score,  0,   sizeof( ScoreRecord));
+    strncpy( score->name,  name,   31);
+    return  score;
+}
+
+void  mergescore( const char  *name,   int  wins,  int  addwins)  {
+    ScoreRecord  *score  =  findscore( name);
+    if ( !score)  return;
+    int  merged  =  addwins  ?  score->wins   +  addwins  :  wins;
+    if ( merged  <=  score->wins)  return;
+    score->wins  =  merged;
+    scoresdirty  =  1;
+    broadcastscore( score);
+}
+
+Peer  *choosenode()  {
+    Peer  *best  =  NULL;
+    for ( int i  =  0;   i  <  peercount;  i++)  {
+        Peer  *peer  =  &peers[i];
+        if ( !peer->node  ||  peer->fd   ==  -1  ||  peer->openseats  <=  0)  continue;
+        if ( !best  ||  peer->openseats  >  best->openseats   ||
+             ( peer->openseats  ==  best->openseats  &&   peer->connected  <  best->connected))  {
+            best  =  peer;
+        }
+    }
+    return  best;
+}
+
+void  routeclient( Peer  *peer)  {
+    char  reply[ 128];
+    int  length;
+    Peer  *node  =  choosenode();
+    if ( node)  {
+        node->openseats--;
+        node->connected++;
+        length  =  snprintf( reply,  sizeof( reply),   "%s %s %d\n",  MSG_REDIRECT,   node->host,  node->port);
+        redirects++;
+    }  else  {
+        length  =  snprintf( reply,  sizeof( reply),   "%s FULL %d\n",  MSG_BUSY,   ADMISSION_RETRY_FULL_MS);
+        refusals++;
+    }
+    send( peer->fd,  reply,   length,  MSG_NOSIGNAL  |  MSG_DONTWAIT);
+    close( peer->fd);
+    peer->fd  =  -1;
+}
+
+void  registernode( Peer  *peer,   const char  *line)  {
+    if ( sscanf( line,  MSG_REGISTER  " %63s %d %d",   peer->host,  &peer->port,   &peer->seats)  !=  3)  {
+        close( peer->fd);
+        peer->fd  =  -1;
+        return;
+    }
+    peer->node  =  1;
+    peer->openseats  =  0;
+    printf( "[Coordinator] Node %s:%d registered with %d seats.\n",   peer->host,  peer->port,   peer->seats);
+    fflush( stdout);
+
+    char  scoreline[ 64];
+    for ( int i  =  0;   i  <  scorecount  &&  peer->fd  !=  -1;  i++)  {
+        int  length  =  snprintf( scoreline,  sizeof( scoreline),   "%s %s %d\n",  MSG_SCORE,   scores[i].name,  scores[i].wins);
+        sendpeer( peer,  scoreline,   length);
+    }
+}
+
+void  handleline( Peer  *peer,   const char  *line)  {
+    char  name[ 32];
+    int  first,   second;
+    if ( !peer->node)  {
+        if ( strcmp( line,  MSG_JOIN)   ==  0)  routeclient( peer);
+        else if ( strncmp( line,  MSG_REGISTER  " ",   strlen( MSG_REGISTER)  +  1)  ==  0)  registernode( peer,   line);
+        else  {
+            close( peer->fd);
+            peer->fd   =  -1;
+        }
+        return;
+    }
+
+    peer->lastseen  =  time( NULL);
+    if ( sscanf( line,  MSG_LOAD  " %d %d",   &first,  &second)  ==  2)  {
+        peer->openseats  =  first;
+        peer->connected   =  second;
+    }  else if ( sscanf( line,  MSG_SCORE  " %31s %d",   name,  &first)  ==  2)  {
+        mergescore( name,  first,   0);
+    }  else if ( ( second  =  sscanf( line,  MSG_WON  " %31s %d",   name,  &first))  >=  1)  {
+        mergescore( name,  0,   second  ==  2  &&  first  >  0  ?  first   :  1);
+    }
+}
+
+void  readpeer( Peer  *peer)  {
+    ssize_t  received  =  recv( peer->fd,  peer->input  +  peer->length,   sizeof( peer->input)  -  peer->length  -  1,  0);
+    if ( received  <=  0)  {
+        if ( received  <  0  &&  ( errno  ==  EAGAIN  ||   errno  ==  EINTR))  return;
+        close( peer->fd);
+        peer->fd  =   -1;
+        return;
+    }
+    peer->length  +=  received;
+    peer->input[ peer->length]   =  '\0';
+
+    char  *start  =  peer->input;
+    char  *newline;
+    while ( peer->fd  !=  -1  &&  ( newline  =  strchr( start,   '\n')))  {
+        *newline  =  '\0';
+        if ( newline  >  start  &&  newline[-1]  ==  '\r')   newline[-1]  =  '\0';
+        handleline( peer,  start);
+        start  =   newline  +  1;
+    }
+    peer->length  -=  start   -  peer->input;
+    memmove( peer->input,  start,   peer->length);
+    if ( peer->length  >=  ( int)sizeof( peer->input)   -  1)  {
+        close( peer->fd);
+        peer->fd  =  -1;
+    }
+}
+
+void  expirepeers( time_t  now)  {
+    for ( int i  =  0;   i  <  peercount;  i++)  {
+        Peer  *peer  =  &peers[i];
+        int  deadline  =  peer->node  ?  FEDERATION_TIMEOUT   :  ADMISSION_JOIN_DEADLINE;
+        if ( peer->fd  !=  -1  &&  now  -  peer->lastseen   >  deadline)  {
+            if ( peer->node)  printf( "[Coordinator] Node %s:%d missed its heartbeat.\n",   peer->host,  peer->port);
+            close( peer->fd);
+            peer->fd  =   -1;
+        }
+    }
+}
+
+void  compactpeers()  {
+    int  kept  =  0;
+    for ( int i  =  0;   i  <  peercount;  i++)  {
+        if ( peers[i].fd  ==  -1)  {
+            if ( peers[i].node)  {
+                printf( "[Coordinator] Node %s:%d left.\n",   peers[i].host,  peers[i].port);
+                fflush( stdout);
+            }
+            continue;
+        }
+        if ( kept  !=  i)  peers[kept]   =  peers[i];
+        kept++;
+    }
+    peercount   =  kept;
+}
+
+int  openlistener( int  listenport)  {
+    int  listenfd  =  socket( AF_INET,   SOCK_STREAM  |  SOCK_NONBLOCK  |   SOCK_CLOEXEC,  0);
+    if ( listenfd  <  0)  {
+        perror( "socket");
+        exit( EXIT_FAILURE);
+    }
+    int  option  =  1;
+    setsockopt( listenfd,  SOL_SOCKET,   SO_REUSEADDR,  &option,   sizeof( option));
+
+    struct sockaddr_in  address;
+    memset( &address,   0,  sizeof( address));
+    address.sin_family  =  AF_INET;
+    address.sin_addr.s_addr   =  INADDR_ANY;
+    address.sin_port  =  htons( listenport);
+    if ( bind( listenfd,  ( struct sockaddr  *)&address,   sizeof( address))  <  0  ||  listen( listenfd,   ADMISSION_BACKLOG)  <  0)  {
+        perror( "bind/listen");
+        exit( EXIT_FAILURE);
+    }
+    return  listenfd;
+}
+
+void  acceptpeers( int  listenfd)  {
+    for ( int accepted  =  0;   accepted  <  ADMISSION_BATCH;  accepted++)  {
+        int  fd  =  accept4( listenfd,  NULL,   NULL,  SOCK_NONBLOCK  |   SOCK_CLOEXEC);
+        if ( fd  <  0)  {
+            if ( errno  ==  EINTR  ||  errno   ==  ECONNABORTED)  continue;
+            break;
+        }
+        if ( peercount  >=  FEDERATION_MAX_PEERS)  {
+            close( fd);
+            continue;
+        }
+        Peer  *peer  =  &peers[ peercount++];
+        memset( peer,  0,   sizeof( Peer));
+        peer->fd  =  fd;
+        peer->lastseen  =   time( NULL);
+    }
+}
+
+void  signalhandler( int  signal)  {
+    printf( "\n[Coordinator] Shutting down after %ld redirects and %ld refusals.\n",   redirects,  refusals);
+    savefederationscores();
+    exit( 0);
+}
+
+int  main( int  argc,   char  *argv[])  {
+    int  listenport  =  COORDINATOR_PORT;
+    int  option;
+    while ( ( option  =  getopt( argc,  argv,   "p:f:"))  !=  -1)  {
+        switch ( option)  {
+            case  'p':  listenport  =  atoi( optarg);   break;
+            case  'f':  scorefile  =   optarg;  break;
+            default:
+                fprintf( stderr,  "Usage: %s [-p port] [-f scorefile]\n",   argv[0]);
+                return  1;
+        }
+    }
+    signal( SIGINT,  signalhandler);
+    signal( SIGPIPE,   SIG_IGN);
+
+    loadfederationscores();
+    int  listenfd  =  openlistener( listenport);
+    printf( "[Coordinator] Routing players on port %d...\n",   listenport);
+    fflush( stdout);
+
+    static struct pollfd  pollfds[ FEDERATION_MAX_PEERS  +  1];
+    time_t  lastexpiry  =  time( NULL);
+    time_t  lastsave  =  lastexpiry;
+    while ( 1)  {
+        pollfds[0].fd  =  listenfd;
+        pollfds[0].events  =   POLLIN;
+        for ( int i  =  0;   i  <  peercount;  i++)  {
+            pollfds[i  +  1].fd  =   peers[i].fd;
+            pollfds[i  +  1].events  =  POLLIN;
+            pollfds[i  +  1].revents   =  0;
+        }
+        int  count  =  peercount;
+        if ( poll( pollfds,  count  +  1,   FEDERATION_HEARTBEAT  *  1000)  <  0)  {
+            if ( errno  ==  EINTR)   continue;
+            perror( "poll");
+            continue;
+        }
+
+        for ( int i  =  0;   i  <  count;  i++)  {
+            if ( peers[i].fd  !=  -1  &&  ( pollfds[i  +  1].revents   &  ( POLLIN  |  POLLHUP  |   POLLERR)))  readpeer( &peers[i]);
+        }
+        if ( pollfds[0].revents  &  POLLIN)   acceptpeers( listenfd);
+
+        time_t  now  =  time( NULL);
+        if ( now  !=  lastexpiry)  {
+            expirepeers( now);
+            lastexpiry  =   now;
+        }
+        if ( scoresdirty  &&  now  -  lastsave  >=   COORDINATOR_SAVE_SECS)  {
+            savefederationscores();
+            lastsave  =   now;
+        }
+        compactpeers();
+    }
+}
@@ -0,0 +1,382 @@
+#include "engine.h"
+#include "trace.h"
+
+static const char  symbols[]  =  { 'X',  'O',  '#',  '@',   '$'};
+static const char  digits[]  =  "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+static const int  directions[4][2]  =  { { 0,  1},  { 1,   0},  { 1,  1},   { 1,  -1}};
+
+static size_t  cellbytes( int  boardsize,   size_t  width)  {
+    return  ( ( size_t)boardsize  *  boardsize  *   width  +  7)  &  ~( size_t)7;
+}
+
+size_t  enginesize( int  maxplayers,   int  boardsize)  {
+    size_t  boardbytes  =  cellbytes( boardsize,   sizeof( uint16_t));
+    size_t  wordbytes   =  cellbytes( boardsize,  sizeof( uint32_t));
+    return  6  *  boardbytes  +  ( 4  +  ( size_t)maxplayers)   *  wordbytes  +  ( size_t)maxplayers  *  ( boardsize  +   4)  *  sizeof( int);
+}
+
+void  engineinit( GameState  *state,   void  *memory,  int  maxplayers,   int  boardsize,  int  winlength)  {
+    size_t  boardbytes  =  cellbytes( boardsize,   sizeof( uint16_t));
+    size_t  wordbytes   =  cellbytes( boardsize,  sizeof( uint32_t));
+    char  *cursor  =  memory;
+    memset( state,  0,   sizeof( GameState));
+    memset( memory,  0,   enginesize( maxplayers,  boardsize));
+    state->board  =  ( uint16_t  *)cursor;
+    state->windows  =  ( uint16_t  *)( cursor  +=   boardbytes);
+    state->windowcounts  =  ( uint8_t  *)( cursor  +=  4  *   boardbytes);
+    state->threattotal  =  ( uint32_t  *)( cursor  +=   wordbytes);
+    state->hotnext  =  ( int  *)( cursor  +=  wordbytes);
+    state->hotprev   =  ( int  *)( cursor  +=  wordbytes);
+    state->hotcounts  =  ( uint16_t  *)( cursor  +=   wordbytes);
+    state->threats  =  ( uint32_t  *)( cursor  +=  boardbytes);
+    state->levels   =  ( int  *)( cursor  +=  ( size_t)maxplayers  *   wordbytes);
+    state->active  =  state->levels  +   ( size_t)maxplayers  *  ( boardsize  +  1);
+    state->next  =  state->active  +   maxplayers;
+    state->previous  =  state->next  +  maxplayers;
+    state->maxplayers  =   maxplayers;
+    state->boardsize  =  boardsize;
+    state->winlength   =  winlength;
+
+    state->cellwidth  =  1;
+    if ( maxplayers  >  ( int)sizeof( symbols))  {
+        for ( long capacity  =  36;   capacity  <=  maxplayers;  capacity  *=   36)  state->cellwidth++;
+    }
+    enginereset( state);
+}
+
+static int  windowstart( const GameState  *state,   int  direction,  int  row,   int  col)  {
+    int  size  =  state->boardsize;
+    int  endrow  =  row  +  ( state->winlength  -  1)  *   directions[direction][0];
+    int  endcol   =  col  +  ( state->winlength  -  1)  *  directions[direction][1];
+    if ( row  <  0  ||  col  <  0  ||  col  >=  size   ||  endrow  >=  size  ||  endcol  <  0  ||   endcol  >=  size)  return  -1;
+    return  ( direction  *  size  +  row)  *  size   +  col;
+}
+
+static int  windowrange( int  position,   int  step,  int  size,   int  last,  int  *first)  {
+    if ( step  ==  0)  return  last;
+    int  low  =  step  >  0  ?  position  +  last  -  size  +  1   :  last  -  position;
+    if ( low  >  *first)  *first  =  low;
+    int  high  =  step  >  0  ?  position   :  size  -  1  -  position;
+    return  high  <  last  ?  high   :  last;
+}
+
+static uint32_t  threatweight( int  count)  {
+    int  shift  =  5  *  ( count  -  1);
+    return  count  <=  0  ?  0   :  1u  <<  ( shift  >  25  ?  25  :  shift);
+}
+
+static int  hotlevel( const GameState  *state)  {
+    return  state->winlength  >  3  ?  state->winlength  -   2  :  1;
+}
+
+static void  linkhot( GameState  *state,   int  cell)  {
+    if ( state->hotcounts[cell]++  >  0)  return;
+    state->hotprev[cell]  =  -1;
+    state->hotnext[cell]   =  state->hothead;
+    if ( state->hothead  !=  -1)  state->hotprev[ state->hothead]   =  cell;
+    state->hothead  =  cell;
+}
+
+static void  unlinkhot( GameState  *state,   int  cell,  int  all)  {
+    if ( state->hotcounts[cell]  ==  0)  return;
+    if ( !all  &&  --state->hotcounts[cell]   >  0)  return;
+    state->hotcounts[cell]  =  0;
+    if ( state->hotprev[cell]  !=  -1)  state->hotnext[ state->hotprev[cell]]   =  state->hotnext[cell];
+    else  state->hothead  =  state->hotnext[cell];
+    if ( state->hotnext[cell]  !=  -1)  state->hotprev[ state->hotnext[cell]]   =  state->hotprev[cell];
+}
+
+static void  scorewindow( GameState  *state,   int  player,  int  cell,  int  stride,   int  before,  int  after)  {
+    uint32_t  *threats  =  state->threats  +  ( size_t)player   *  state->boardsize  *  state->boardsize;
+    uint32_t  delta  =  threatweight( after)  -   threatweight( before);
+    int  hot  =  hotlevel( state);
+    int  change  =  ( after  >=  hot)  -  ( before   >=  hot);
+    for ( int k  =  0;   k  <  state->winlength;  k++,  cell  +=   stride)  {
+        if ( state->board[cell])  continue;
+        threats[cell]  +=  delta;
+        state->threattotal[cell]   +=  delta;
+        if ( change  >  0)  linkhot( state,   cell);
+        else if ( change  <  0)  unlinkhot( state,   cell,  0);
+    }
+    int  *levels  =  state->levels  +  ( size_t)player   *  ( state->boardsize  +  1);
+    if ( before)  levels[before]--;
+    if ( after)   levels[after]++;
+}
+
+static void  markwindows( GameState  *state,   int  mark,  int  row,  int  col)  {
+    int  size  =  state->boardsize;
+    int  last   =  state->winlength  -  1;
+    for ( int d  =  0;   d  <  4;  d++)  {
+        int  first  =  0;
+        int  rowlimit  =  windowrange( row,   directions[d][0],  size,   last,  &first);
+        int  collimit   =  windowrange( col,  directions[d][1],   size,  last,  &first);
+        int  limit  =  rowlimit  <  collimit  ?  rowlimit   :  collimit;
+        int  stride  =  directions[d][0]  *  size   +  directions[d][1];
+        int  window  =  ( d  *  size   +  row)  *  size  +  col;
+        for ( int k  =  first;   k  <=  limit;  k++)  {
+            int  current  =  window  -  k  *  stride;
+            int  start  =  current  -  d  *  size   *  size;
+            uint16_t  *owner  =  state->windows  +  current;
+            int  count  =  state->windowcounts[current];
+            if ( *owner  ==  0  ||  *owner  ==   mark)  {
+                *owner  =  mark;
+                state->windowcounts[current]  =   count  +  1;
+                scorewindow( state,  mark  -  1,   start,  stride,  count,   count  +  1);
+            }  else if ( *owner  !=  WINDOW_DEAD)  {
+                scorewindow( state,  *owner  -   1,  start,  stride,   count,  0);
+                *owner  =  WINDOW_DEAD;
+                state->livewindows--;
+            }
+        }
+    }
+}
+
+void  enginereset( GameState  *state)  {
+    int  size  =  state->boardsize;
+    int  span  =  size  -  state->winlength  +   1;
+    memset( state->board,  0,   ( size_t)state->boardsize  *  state->boardsize  *   sizeof( uint16_t));
+    memset( state->windows,   0,  4  *  ( size_t)size  *   size  *  sizeof( uint16_t));
+    memset( state->windowcounts,  0,   4  *  ( size_t)size  *  size);
+    memset( state->threattotal,   0,  ( size_t)size  *  size   *  sizeof( uint32_t));
+    memset( state->hotcounts,  0,   ( size_t)size  *  size  *   sizeof( uint16_t));
+    memset( state->threats,   0,  ( size_t)state->maxplayers  *  size   *  size  *  sizeof( uint32_t));
+    memset( state->levels,  0,   ( size_t)state->maxplayers  *  ( size  +   1)  *  sizeof( int));
+    state->hothead  =  -1;
+    state->livewindows  =  span  >  0  ?  2  *  size  *  span   +  2  *  span  *  span  :  0;
+    state->gameover   =  0;
+    state->winner  =  -1;
+    state->movecount  =  0;
+    state->running   =  0;
+}
+
+void  enginestart( GameState  *state,   int  playercount)  {
+    enginereset( state);
+    state->playercount  =  playercount;
+    state->currentturn   =  0;
+    state->activecount  =  0;
+    state->running   =  1;
+
+    int  first  =  -1,   last  =  -1;
+    for ( int i  =  0;   i  <  playercount;  i++)  {
+        if ( !state->active[i])  continue;
+        if ( first  ==  -1)  first  =   i;
+        else  {
+            state->next[last]  =  i;
+            state->previous[i]   =  last;
+        }
+        last  =  i;
+        state->activecount++;
+    }
+    if ( first  !=  -1)  {
+        state->next[last]  =  first;
+        state->previous[first]   =  last;
+        state->currentturn  =  first;
+    }
+}
+
+int  enginenextplayer( GameState  *state)  {
+    if ( state->activecount  ==  0)  return  -1;
+    int  current   =  state->currentturn;
+    while ( !state->active[current])  current  =   state->next[current];
+    state->currentturn  =  current;
+    return  current;
+}
+
+void  engineadvance( GameState  *state)  {
+    state->currentturn  =  state->next[ state->currentturn];
+}
+
+static int  countdirection( const GameState  *state,   int  mark,  int  row,  int  col,   int  rowstep,  int  colstep)  {
+    int  size  =  state->boardsize;
+    int  count  =  0;
+    row  +=  rowstep;
+    col  +=  colstep;
+    while ( row  >=  0  &&  row  <  size  &&   col  >=  0  &&  col  <  size  &&  state->board[ row  *  size  +  col]   ==  mark)  {
+        count++;
+        row  +=  rowstep;
+        col  +=  colstep;
+    }
+    return  count;
+}
+
+static int  winsat( const GameState  *state,   int  mark,  int  row,  int  col)  {
+    for ( int d  =  0;   d  <  4;  d++)  {
+        int  run  =  1  +  countdirection( state,   mark,  row,  col,  directions[d][0],   directions[d][1])
+                        +  countdirection( state,  mark,   row,   col,  -directions[d][0],  -directions[d][1]);
+        if ( run  >=  state->winlength)  return   1;
+    }
+    return  0;
+}
+
+int  engineplay( GameState  *state,   int  player,  int  row,   int  col)  {
+    int  size  =  state->boardsize;
+    if ( state->gameover  ||  player  <  0  ||   player  >=  state->playercount)  return  MOVE_INVALID;
+    if ( row  <  0  ||  row  >=  size  ||   col  <  0  ||  col  >=  size  ||  state->board[ row  *  size  +  col]   !=  0)  return  MOVE_INVALID;
+
+    state->board[ row  *  size  +  col]  =  player  +   1;
+    state->movecount++;
+
+    TRACE_BEGIN( checkstart);
+    int  won  =  winsat( state,  player  +  1,   row,   col);
+    TRACE_END( TRACE_CHECKWIN,  checkstart,   won);
+    if ( won)  {
+        state->winner  =  player;
+        state->gameover   =  1;
+        return  MOVE_WIN;
+    }
+
+    unlinkhot( state,  row  *  size   +  col,  1);
+    markwindows( state,   player  +  1,  row,  col);
+    if ( state->movecount  >=  size  *   size  ||  state->livewindows  ==   0)  {
+        state->winner  =  -1;
+        state->gameover   =  1;
+        return  MOVE_DRAW;
+    }
+    return  MOVE_PLAYED;
+}
+
+int  enginewinningmove( const GameState  *state,   int  player,  int  row,   int  col)  {
+    if ( state->board[ row  *  state->boardsize  +  col]  !=  0)  return  0;
+    return  winsat( state,   player  +  1,  row,   col);
+}
+
+void  enginedrop( GameState  *state,  int  player)  {
+    if ( player  <  0  ||  player   >=  state->maxplayers  ||  !state->active[player])  return;
+    state->active[player]  =  0;
+    if ( !state->running)  return;
+
+    state->activecount--;
+    state->next[ state->previous[player]]  =  state->next[player];
+    state->previous[ state->next[player]]   =  state->previous[player];
+}
+
+int  enginecheckwin( const GameState  *state,   int  player)  {
+    int  size  =  state->boardsize;
+    int  length  =  state->winlength;
+    for ( int row  =  0;   row  <  size;  row++)  {
+        for ( int col  =  0;  col  <   size;  col++)  {
+            for ( int d  =  0;   d  <  4;  d++)  {
+                int  count  =  0;
+                for ( int k  =  0;   k  <  length;  k++)  {
+                    int  r  =  row  +  k  *  directions[d][0],   c  =  col  +  k  *  directions[d][1];
+                    if ( r  <  0  ||  r  >=  size  ||   c  <  0  ||  c  >=  size  ||  state->board[ r  *  size  +  c]   !=  player  +  1)  break;
+                    count++;
+                }
+                if ( count  ==  length)   return  1;
+            }
+        }
+    }
+    return  0;
+}
+
+int  engineboardfull( const GameState  *state)  {
+    for( int i=0;  i<state->boardsize  *  state->boardsize;   i++)
+        if( state->board[i]  ==   0)  return  0;
+    return  1;
+}
+
+int  enginecountlive( const GameState  *state)  {
+    int  size  =  state->boardsize;
+    int  live  =  0;
+    for ( int d  =  0;   d  <  4;  d++)  {
+        for ( int row  =  0;   row  <  size;  row++)  {
+            for ( int col  =  0;   col  <  size;  col++)  {
+                if ( windowstart( state,  d,   row,  col)  ==  -1)  continue;
+                int  owner  =  0;
+                for ( int k  =  0;   k  <  state->winlength  &&  owner   !=  -1;  k++)  {
+                    int  mark  =  state->board[ ( row  +  k  *  directions[d][0])  *  size   +  col  +  k  *  directions[d][1]];
+                    if ( mark  ==  0  ||  mark   ==  owner)  continue;
+                    owner  =  owner  ?  -1   :  mark;
+                }
+                if ( owner  !=  -1)  live++;
+            }
+        }
+    }
+    return  live;
+}
+
+static void  ratehint( const GameState  *state,   int  player,  int  cell,   long long  *rating)  {
+    int  size  =  state->boardsize;
+    uint32_t  own  =  state->threats[ ( size_t)player  *  size   *  size  +  cell];
+    uint32_t  opponents  =  state->threattotal[cell]   -  own;
+    uint32_t  finishing  =  threatweight( state->winlength   -  1);
+    int  tier  =  own  >=  finishing  ?  2   :  opponents  >=  finishing;
+    int  centre  =  abs( 2  *  ( cell  /  size)  -   size  +  1)  +  abs( 2  *  ( cell  %  size)   -  size  +  1);
+    *rating  =  ( ( long long)tier  <<  40)   +  ( ( long long)( 2  *  ( uint64_t)own   +  opponents)  <<  8)  -  centre;
+}
+
+int  enginehint( const GameState  *state,   int  player,  int  *row,   int  *col)  {
+    int  size  =  state->boardsize;
+    int  best  =  -1;
+    long long  bestrating  =  0,   rating;
+    for ( int cell  =  state->hothead;   cell  !=  -1;  cell  =   state->hotnext[cell])  {
+        ratehint( state,  player,   cell,  &rating);
+        if ( best  ==  -1  ||  rating   >  bestrating)  {
+            best  =  cell;
+            bestrating   =  rating;
+        }
+    }
+    int  hot  =  best  !=  -1;
+    for ( int cell  =  0;   !hot  &&  cell  <  size   *  size;  cell++)  {
+        if ( state->board[cell])  continue;
+        ratehint( state,   player,  cell,  &rating);
+        if ( best  ==  -1  ||  rating   >  bestrating)  {
+            best  =  cell;
+            bestrating   =  rating;
+        }
+    }
+    if ( best  ==  -1)  return  0;
+    *row  =  best  /  size;
+    *col   =  best  %  size;
+    return  1;
+}
+
+int  enginethreat( const GameState  *state,   int  player,  int  *windows)  {
+    const int  *levels  =  state->levels  +  ( size_t)player   *  ( state->boardsize  +  1);
+    for ( int count  =  state->winlength  -  1;   count  >  0;  count--)  {
+        if ( levels[count]  >  0)  {
+            *windows  =  levels[count];
+            return   count;
+        }
+    }
+    *windows  =  0;
+    return  0;
+}
+
+void  engineidentifier( const GameState  *state,   int  player,  char  *identifier)  {
+    if ( state->maxplayers  <=  ( int)sizeof( symbols))  {
+        identifier[0]  =  symbols[ player];
+    }  else  {
+        int  value  =  player  +  1;
+        for ( int i  =  state->cellwidth  -  1;   i  >=  0;  i--)  {
+            identifier[i]  =  digits[ value  %  36];
+            value  /=   36;
+        }
+    }
+    identifier[ state->cellwidth]  =  '\0';
+}
+
+int  enginerendersize( const GameState  *state)  {
+    return  state->boardsize  *  ( state->boardsize  *  state->cellwidth   +  1);
+}
+
+int  enginerender( const GameState  *state,   char  *output)  {
+    int  size  =  state->boardsize;
+    int  position  =  0;
+    char  identifier[ 8];
+    for( int row=0;  row<size;   row++)  {
+        for( int col=0;   col<size;  col++)  {
+            int  mark  =  state->board[ row  *  size  +  col];
+            if ( mark  ==  0)  {
+                memset( output  +  position,  ' ',   state->cellwidth);
+            }  else  {
+                engineidentifier( state,  mark  -  1,   identifier);
+                memcpy( output  +  position,  identifier,   state->cellwidth);
+            }
+            position  +=  state->cellwidth;
+        }
+        output[position++]   =  '\n';
+    }
+    return  position;
+}
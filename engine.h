@@ -0,0 +1,30 @@
+#ifndef ENGINE_H
+#define  ENGINE_H
+
+#include "common.h"
+
+#define MOVE_INVALID  0
+#define  MOVE_PLAYED  1
+#define MOVE_WIN   2
+#define  MOVE_DRAW  3
+#define WINDOW_DEAD   0xFFFF
+
+size_t  enginesize( int  maxplayers,   int  boardsize);
+void  engineinit( GameState  *state,   void  *memory,  int  maxplayers,   int  boardsize,  int  winlength);
+void  enginereset( GameState  *state);
+void  enginestart( GameState  *state,   int  playercount);
+int  enginenextplayer( GameState  *state);
+void  engineadvance( GameState  *state);
+int  engineplay( GameState  *state,   int  player,  int  row,   int  col);
+int  enginewinningmove( const GameState  *state,   int  player,  int  row,   int  col);
+void  enginedrop( GameState  *state,  int  player);
+int  enginecheckwin( const GameState  *state,   int  player);
+int  engineboardfull( const GameState  *state);
+int  enginecountlive( const GameState  *state);
+int  enginehint( const GameState  *state,   int  player,  int  *row,   int  *col);
+int  enginethreat( const GameState  *state,   int  player,  int  *windows);
+void  engineidentifier( const GameState  *state,   int  player,  char  *identifier);
+int  enginerendersize( const GameState  *state);
+int  enginerender( const GameState  *state,   char  *output);
+
+#endif
@@ -0,0 +1,110 @@
+#include "common.h"
+
+typedef  struct {
+    char  name[32];
+    int   games;
+}  Opponent;
+
+void  *mapfile( int  fd,   size_t  *length)  {
+    if ( fd  ==  -1)  return  NULL;
+    struct stat  info;
+    if ( fstat( fd,  &info)  ==  -1  ||   info.st_size  ==  0)  return  NULL;
+    void  *data  =  mmap( NULL,   info.st_size,  PROT_READ,  MAP_SHARED,   fd,  0);
+    if ( data  ==  MAP_FAILED)  return  NULL;
+    *length  =  info.st_size;
+    return  data;
+}
+
+void  addopponent( Opponent  *opponents,   int  *count,  const char  *name)  {
+    for ( int i  =  0;   i  <  *count;  i++)  {
+        if ( strncmp( opponents[i].name,  name,   32)  ==  0)  {
+            opponents[i].games++;
+            return;
+        }
+    }
+    if ( *count  >=  1000)  return;
+    strncpy( opponents[*count].name,   name,  31);
+    opponents[*count].games  =  1;
+    ( *count)++;
+}
+
+int  main( int  argc,   char  *argv[])  {
+    if ( argc  <  2)  {
+        fprintf( stderr,  "Usage: %s PLAYER [LAST_GAMES]\n",   argv[0]);
+        return  1;
+    }
+    const char  *player  =  argv[1];
+    int  limit  =  argc  >  2  ?  atoi( argv[2])   :  1000;
+
+    struct timespec  start,   end;
+    clock_gettime( CLOCK_MONOTONIC,  &start);
+
+    size_t  historylength  =  0,   indexlength  =  0;
+    int  indexfd  =  open( HISTORY_INDEX_FILE,   O_RDONLY);
+    if ( indexfd  !=  -1)  flock( indexfd,  LOCK_SH);
+    int  historyfd  =  open( HISTORY_FILE,   O_RDONLY);
+    HistoryRecord  *records  =  mapfile( historyfd,   &historylength);
+    HistoryIndex  *index  =  mapfile( indexfd,  &indexlength);
+    if ( !records  ||  !index  ||   indexlength  <  sizeof( HistoryIndex)  ||  index->slotcount  <=  0  ||   indexlength  <  historyindexsize( index->slotcount))  {
+        fprintf( stderr,  "No match history found (%s / %s).\n",   HISTORY_FILE,  HISTORY_INDEX_FILE);
+        return  1;
+    }
+    int  rows  =  historylength  /  sizeof( HistoryRecord);
+
+    HistorySlot  *entry  =  NULL;
+    unsigned int  slot  =  historyhash( player)  %  index->slotcount;
+    for ( int probe  =  0;   probe  <  index->slotcount;  probe++)  {
+        HistorySlot  *candidate  =  &index->slots[ ( slot  +  probe)   %  index->slotcount];
+        if ( candidate->name[0]  ==  '\0')  break;
+        if ( strncmp( candidate->name,   player,  32)  ==  0)  {
+            entry  =  candidate;
+            break;
+        }
+    }
+    if ( !entry)  {
+        printf( "No games recorded for %s.\n",   player);
+        return  0;
+    }
+
+    int  games  =  0,   wins  =  0,  losses  =  0,   draws  =  0;
+    long long  winmoves  =  0;
+    Opponent  *opponents  =  calloc( 1000,   sizeof( Opponent));
+    int  opponentcount  =  0;
+
+    for ( int row  =  entry->lastrow;   row  >=  0  &&  row  <  rows  &&   games  <  limit;  row  =  records[row].previous)  {
+        HistoryRecord  *record  =  &records[row];
+        games++;
+        if ( record->result  ==  'W')  {
+            wins++;
+            winmoves  +=   record->moves;
+        }  else if ( record->result  ==  'L')  losses++;
+        else  draws++;
+
+        for ( int other  =  record->game;   other  <  rows  &&  records[other].game   ==  record->game;  other++)  {
+            if ( other  !=  row)  addopponent( opponents,   &opponentcount,  records[other].name);
+        }
+    }
+
+    flock( indexfd,  LOCK_UN);
+    clock_gettime( CLOCK_MONOTONIC,   &end);
+    double  elapsed  =  ( end.tv_sec  -  start.tv_sec)  *  1000.0   +  ( end.tv_nsec  -  start.tv_nsec)  /  1e6;
+
+    printf( "Player: %s (%d games recorded, last %d analysed)\n",   player,  entry->games,   games);
+    printf( "Wins: %d  Losses: %d  Draws: %d  Win rate: %.1f%%\n",   wins,  losses,   draws,  games  ?  100.0  *  wins  /  games  :  0.0);
+    printf( "Average moves to win: %.1f\n",   wins  ?  ( double)winmoves  /  wins  :   0.0);
+    printf( "Opponents faced: %d\n",   opponentcount);
+    for ( int shown  =  0;   shown  <  5  &&  shown  <  opponentcount;  shown++)  {
+        int  best  =  shown;
+        for ( int i  =  shown  +  1;   i  <  opponentcount;  i++)  {
+            if ( opponents[i].games  >  opponents[best].games)   best  =  i;
+        }
+        Opponent  swap  =  opponents[shown];
+        opponents[shown]  =  opponents[best];
+        opponents[best]   =  swap;
+        printf( "  %-20s %d games\n",   opponents[shown].name,  opponents[shown].games);
+    }
+    printf( "Query time: %.3f ms over %d records\n",   elapsed,  rows);
+
+    free( opponents);
+    return  0;
+}
@@ -0,0 +1,536 @@
+#include "common.h"
+
+#define LOGSTATS_MAX_SHARDS  64
+#define  LOGSTATS_MIN_CHUNK  ( 4  *  1024  *  1024)
+#define LOGSTATS_OPENING_MOVES  2
+
+#define EVENT_NONE  0
+#define  EVENT_START  1
+#define EVENT_WIN   2
+#define  EVENT_DRAW  3
+#define EVENT_RESET   4
+
+#define SHARD_UNSEEN  0
+#define  SHARD_UNKNOWN  1
+#define SHARD_OPEN   2
+#define  SHARD_CLOSED  3
+
+typedef  struct {
+    const char  *name;
+    int   length;
+    int  moves;
+}  Participant;
+
+typedef struct  {
+    Participant  *participants;
+    int   count;
+    int  capacity;
+    int  moves;
+    int   opening[ LOGSTATS_OPENING_MOVES];
+    int  lastmover;
+    int   terminator;
+}  Fragment;
+
+typedef  struct {
+    int  state;
+    Fragment   prefix;
+    Fragment  game;
+}  ShardState;
+
+typedef struct  {
+    const char  *name;
+    int   length;
+    long  games;
+    long   wins;
+    long  draws;
+    long   losses;
+    long  moves;
+}  PlayerStats;
+
+typedef  struct {
+    uint32_t  key;
+    long   games;
+    long  firstwins;
+    long  draws;
+    long   moves;
+}  OpeningStats;
+
+typedef struct  {
+    PlayerStats  *players;
+    size_t   playercapacity;
+    size_t  playercount;
+    OpeningStats  *openings;
+    size_t   openingcapacity;
+    size_t  openingcount;
+    long  games;
+    long   draws;
+    long  abandoned;
+    long   moves;
+    long  lines;
+}  Stats;
+
+typedef  struct {
+    const char  *start;
+    const char   *end;
+    ShardState  shards[ LOGSTATS_MAX_SHARDS];
+    Stats   stats;
+}  Chunk;
+
+Chunk  *chunks;
+int  chunkcount;
+int   nextchunk;
+
+uint64_t  hashname( const char  *name,   int  length)  {
+    uint64_t  hash  =  1469598103934665603ULL;
+    for ( int i  =  0;   i  <  length;  i++)  {
+        hash  ^=  ( unsigned char)name[i];
+        hash  *=   1099511628211ULL;
+    }
+    return  hash;
+}
+
+PlayerStats  *findplayer( Stats  *stats,   const char  *name,  int  length)  {
+    if ( ( stats->playercount  +  1)  *  2   >  stats->playercapacity)  {
+        size_t  oldcapacity  =  stats->playercapacity;
+        PlayerStats  *old  =  stats->players;
+        stats->playercapacity  =  oldcapacity  ?  oldcapacity  *  2   :  256;
+        stats->players  =  calloc( stats->playercapacity,   sizeof( PlayerStats));
+        stats->playercount  =  0;
+        for ( size_t i  =  0;   i  <  oldcapacity;  i++)  {
+            if ( !old[i].name)  continue;
+            PlayerStats  *entry  =  findplayer( stats,   old[i].name,  old[i].length);
+            *entry  =  old[i];
+        }
+        free( old);
+    }
+
+    size_t  mask  =  stats->playercapacity  -  1;
+    for ( size_t slot  =  hashname( name,   length)  &  mask;  ;   slot  =  ( slot  +  1)  &  mask)  {
+        PlayerStats  *entry  =  &stats->players[slot];
+        if ( !entry->name)  {
+            entry->name  =  name;
+            entry->length   =  length;
+            stats->playercount++;
+            return  entry;
+        }
+        if ( entry->length  ==  length  &&  memcmp( entry->name,   name,  length)  ==  0)   return  entry;
+    }
+}
+
+OpeningStats  *findopening( Stats  *stats,   uint32_t  key)  {
+    if ( ( stats->openingcount  +  1)  *  2   >  stats->openingcapacity)  {
+        size_t  oldcapacity  =  stats->openingcapacity;
+        OpeningStats  *old  =  stats->openings;
+        stats->openingcapacity  =  oldcapacity  ?  oldcapacity  *  2   :  256;
+        stats->openings  =  calloc( stats->openingcapacity,   sizeof( OpeningStats));
+        stats->openingcount  =  0;
+        for ( size_t i  =  0;   i  <  oldcapacity;  i++)  {
+            if ( !old[i].key)  continue;
+            *findopening( stats,   old[i].key)  =  old[i];
+        }
+        free( old);
+    }
+
+    size_t  mask  =  stats->openingcapacity  -  1;
+    for ( size_t slot  =  ( key  *  2654435761u)  &  mask;  ;   slot  =  ( slot  +  1)  &  mask)  {
+        OpeningStats  *entry  =  &stats->openings[slot];
+        if ( !entry->key)  {
+            entry->key  =  key;
+            stats->openingcount++;
+            return  entry;
+        }
+        if ( entry->key  ==  key)  return   entry;
+    }
+}
+
+void  clearfragment( Fragment  *fragment)  {
+    fragment->count  =  0;
+    fragment->moves   =  0;
+    fragment->lastmover  =  -1;
+    fragment->terminator   =  EVENT_NONE;
+    for ( int i  =  0;   i  <  LOGSTATS_OPENING_MOVES;  i++)  fragment->opening[i]   =  -1;
+}
+
+int  addparticipant( Fragment  *fragment,   const char  *name,  int  length)  {
+    for ( int i  =  fragment->count  -  1;   i  >=  0;  i--)  {
+        Participant  *participant  =  &fragment->participants[i];
+        if ( participant->length  ==  length  &&  memcmp( participant->name,   name,  length)  ==  0)   return  i;
+    }
+    if ( fragment->count  ==  fragment->capacity)  {
+        fragment->capacity  =  fragment->capacity  ?  fragment->capacity  *  2   :  8;
+        fragment->participants  =  realloc( fragment->participants,   fragment->capacity  *  sizeof( Participant));
+    }
+    fragment->participants[ fragment->count]  =  ( Participant){ name,   length,  0};
+    return  fragment->count++;
+}
+
+void  addmove( Fragment  *fragment,   const char  *name,  int  length,  int  cell)  {
+    int  mover  =  addparticipant( fragment,   name,  length);
+    fragment->participants[mover].moves++;
+    if ( fragment->moves  <  LOGSTATS_OPENING_MOVES)  fragment->opening[ fragment->moves]   =  cell;
+    fragment->moves++;
+    fragment->lastmover  =  mover;
+}
+
+void  appendfragment( Fragment  *game,   const Fragment  *tail)  {
+    for ( int i  =  0;   i  <  tail->count;  i++)  {
+        int  mover  =  addparticipant( game,   tail->participants[i].name,  tail->participants[i].length);
+        game->participants[mover].moves  +=   tail->participants[i].moves;
+        if ( i  ==  tail->lastmover)  game->lastmover   =  mover;
+    }
+    for ( int i  =  0;   i  <  LOGSTATS_OPENING_MOVES  &&  game->moves  +  i  <   LOGSTATS_OPENING_MOVES;  i++)  {
+        game->opening[ game->moves  +  i]  =  tail->opening[i];
+    }
+    game->moves  +=  tail->moves;
+}
+
+void  finishgame( Stats  *stats,   const Fragment  *game,  int  result)  {
+    if ( game->moves  ==  0)  {
+        stats->abandoned++;
+        return;
+    }
+    int  winner  =  result  ==  EVENT_WIN  ?  game->lastmover   :  -1;
+    for ( int i  =  0;   i  <  game->count;  i++)  {
+        PlayerStats  *player  =  findplayer( stats,   game->participants[i].name,  game->participants[i].length);
+        player->games++;
+        player->moves  +=  game->participants[i].moves;
+        if ( i  ==  winner)  player->wins++;
+        else if ( result  ==  EVENT_DRAW)  player->draws++;
+        else  player->losses++;
+    }
+
+    uint32_t  key  =  1;
+    for ( int i  =  0;   i  <  LOGSTATS_OPENING_MOVES;  i++)  key  =   key  *  ( LOBBY_MAX_BOARD  *  LOBBY_MAX_BOARD  +  1)  +  ( game->opening[i]   +  1);
+    OpeningStats  *opening  =  findopening( stats,   key);
+    opening->games++;
+    opening->moves  +=  game->moves;
+    if ( winner  ==  0)  opening->firstwins++;
+    if ( result  ==  EVENT_DRAW)  opening->draws++;
+
+    stats->games++;
+    stats->moves  +=  game->moves;
+    if ( result  ==  EVENT_DRAW)  stats->draws++;
+}
+
+const char  *parsenumber( const char  *cursor,   const char  *end,  int  *value)  {
+    *value  =  0;
+    const char  *first  =  cursor;
+    while ( cursor  <  end  &&  *cursor  >=  '0'  &&   *cursor  <=  '9')  *value  =  *value  *  10  +   ( *cursor++  -  '0');
+    return  cursor  ==  first  ?  NULL   :  cursor;
+}
+
+int  parsemove( const char  *message,   const char  *end,  const char  **name,  int  *length,   int  *cell)  {
+    const char  *cursor  =  end  -  1;
+    while ( cursor  >  message  &&  *cursor  !=  ',')   cursor--;
+    int  row,   col;
+    if ( !parsenumber( cursor  +  1,   end,  &col))  return  0;
+    const char  *comma  =  cursor;
+    while ( cursor  >  message  &&  cursor[-1]  >=  '0'  &&   cursor[-1]  <=  '9')  cursor--;
+    if ( parsenumber( cursor,  comma,   &row)  !=  comma)  return  0;
+
+    cursor  -=  4;
+    if ( cursor  <  message  ||  memcmp( cursor,   " at ",  4)  !=  0)  return  0;
+    while ( cursor  >  message  &&  cursor[-1]  !=  ' ')   cursor--;
+    cursor  -=  8;
+    if ( cursor  <  message  +  13  ||  memcmp( cursor,   " placed ",  8)  !=  0)  return  0;
+    if ( row  >=  LOBBY_MAX_BOARD  ||  col   >=  LOBBY_MAX_BOARD)  return  0;
+
+    *name  =  message  +  13;
+    *length  =  cursor  -  *name;
+    *cell   =  row  *  LOBBY_MAX_BOARD  +  col;
+    return  1;
+}
+
+void  applyevent( Chunk  *chunk,   ShardState  *shard,  int  event)  {
+    if ( shard->state  ==  SHARD_UNSEEN  ||  shard->state   ==  SHARD_UNKNOWN)  {
+        shard->prefix.terminator  =  event;
+    }  else if ( shard->state  ==  SHARD_OPEN)  {
+        if ( event  ==  EVENT_WIN  ||  event  ==   EVENT_DRAW)  finishgame( &chunk->stats,  &shard->game,   event);
+        else  chunk->stats.abandoned++;
+    }
+    if ( event  ==  EVENT_START)  {
+        clearfragment( &shard->game);
+        shard->state  =  SHARD_OPEN;
+    }  else  {
+        shard->state  =  SHARD_CLOSED;
+    }
+}
+
+void  parsechunk( Chunk  *chunk)  {
+    for ( int i  =  0;   i  <  LOGSTATS_MAX_SHARDS;  i++)  {
+        clearfragment( &chunk->shards[i].prefix);
+        clearfragment( &chunk->shards[i].game);
+    }
+
+    const char  *line  =  chunk->start;
+    while ( line  <  chunk->end)  {
+        const char  *end  =  memchr( line,  '\n',   chunk->end  -  line);
+        if ( !end)  end  =  chunk->end;
+        const char  *next  =  end  +  1;
+        chunk->stats.lines++;
+
+        if ( end  -  line  <  24  ||  line[0]   !=  '['  ||  line[20]  !=  ']')  {
+            line  =  next;
+            continue;
+        }
+        const char  *message  =  line  +  22;
+        int  shardid  =  0;
+        if ( message[0]  ==  '['  &&  end  -  message   >  7  &&  memcmp( message,  "[Shard ",   7)  ==  0)  {
+            const char  *close  =  parsenumber( message  +  7,   end,  &shardid);
+            if ( !close  ||  shardid  >=  LOGSTATS_MAX_SHARDS  ||   close  +  2  >  end)  {
+                line  =  next;
+                continue;
+            }
+            message  =  close  +  2;
+        }
+        ShardState  *shard  =  &chunk->shards[shardid];
+        if ( shard->state  ==  SHARD_UNSEEN)  shard->state   =  SHARD_UNKNOWN;
+
+        size_t  length  =  end  -  message;
+        const char  *name;
+        int  namelength,   cell;
+        switch ( message[0])  {
+            case  'M':
+                if ( length  >  13  &&  memcmp( message,   "MOVE: Player ",  13)  ==  0  &&   parsemove( message,  end,  &name,   &namelength,  &cell))  {
+                    if ( shard->state  ==  SHARD_UNKNOWN)  addmove( &shard->prefix,   name,  namelength,  cell);
+                    else if ( shard->state  ==  SHARD_OPEN)  addmove( &shard->game,   name,  namelength,  cell);
+                }
+                break;
+            case  'G':
+                if ( length  ==  23  &&  memcmp( message,   "GAME: We have a winner!",  23)  ==  0)   applyevent( chunk,  shard,   EVENT_WIN);
+                else if ( length  ==  23  &&  memcmp( message,   "GAME: Board full. Draw!",  23)  ==  0)   applyevent( chunk,  shard,   EVENT_DRAW);
+                else if ( length  ==  23  &&  memcmp( message,   "GAME: Dead board. Draw!",  23)  ==  0)   applyevent( chunk,  shard,   EVENT_DRAW);
+                else if ( length  ==  18  &&  memcmp( message,   "GAME: Board reset.",  18)  ==  0  &&   shard->state  !=  SHARD_CLOSED)  applyevent( chunk,   shard,  EVENT_RESET);
+                break;
+            case  'S':
+                if ( length  ==  24  &&  memcmp( message,   "SCHEDULER: Game Started!",  24)  ==  0)   applyevent( chunk,  shard,   EVENT_START);
+                break;
+        }
+        line  =  next;
+    }
+}
+
+void  *parserthread( void  *arg)  {
+    int  index;
+    while ( ( index  =  __atomic_fetch_add( &nextchunk,   1,  __ATOMIC_RELAXED))  <  chunkcount)  {
+        parsechunk( &chunks[index]);
+    }
+    return  NULL;
+}
+
+void  stitchchunks( Stats  *stats,   long  *unfinished)  {
+    ShardState  carry[ LOGSTATS_MAX_SHARDS];
+    memset( carry,  0,   sizeof( carry));
+    for ( int s  =  0;   s  <  LOGSTATS_MAX_SHARDS;  s++)  {
+        carry[s].state  =  SHARD_CLOSED;
+        clearfragment( &carry[s].game);
+    }
+
+    for ( int c  =  0;   c  <  chunkcount;  c++)  {
+        for ( int s  =  0;   s  <  LOGSTATS_MAX_SHARDS;  s++)  {
+            ShardState  *shard  =  &chunks[c].shards[s];
+            if ( shard->state  ==  SHARD_UNSEEN)  continue;
+
+            if ( carry[s].state  ==  SHARD_OPEN)  appendfragment( &carry[s].game,   &shard->prefix);
+            if ( shard->state  ==  SHARD_UNKNOWN)  continue;
+
+            if ( carry[s].state  ==  SHARD_OPEN)  {
+                int  terminator  =  shard->prefix.terminator;
+                if ( terminator  ==  EVENT_WIN  ||  terminator   ==  EVENT_DRAW)  finishgame( stats,  &carry[s].game,   terminator);
+                else  stats->abandoned++;
+            }
+            carry[s].state  =  shard->state;
+            clearfragment( &carry[s].game);
+            if ( shard->state  ==  SHARD_OPEN)  appendfragment( &carry[s].game,   &shard->game);
+        }
+    }
+
+    for ( int s  =  0;   s  <  LOGSTATS_MAX_SHARDS;  s++)  {
+        if ( carry[s].state  ==  SHARD_OPEN  &&  carry[s].game.moves   >  0)  ( *unfinished)++;
+        free( carry[s].game.participants);
+    }
+}
+
+void  mergestats( Stats  *total,   Stats  *part)  {
+    for ( size_t i  =  0;   i  <  part->playercapacity;  i++)  {
+        PlayerStats  *source  =  &part->players[i];
+        if ( !source->name)  continue;
+        PlayerStats  *target  =  findplayer( total,   source->name,  source->length);
+        target->games  +=  source->games;
+        target->wins   +=  source->wins;
+        target->draws  +=  source->draws;
+        target->losses   +=  source->losses;
+        target->moves  +=  source->moves;
+    }
+    for ( size_t i  =  0;   i  <  part->openingcapacity;  i++)  {
+        OpeningStats  *source  =  &part->openings[i];
+        if ( !source->key)  continue;
+        OpeningStats  *target  =  findopening( total,   source->key);
+        target->games  +=  source->games;
+        target->firstwins   +=  source->firstwins;
+        target->draws  +=  source->draws;
+        target->moves   +=  source->moves;
+    }
+    total->games  +=  part->games;
+    total->draws   +=  part->draws;
+    total->abandoned  +=  part->abandoned;
+    total->moves   +=  part->moves;
+    total->lines  +=  part->lines;
+    free( part->players);
+    free( part->openings);
+}
+
+int  compareplayers( const void  *a,   const void  *b)  {
+    const PlayerStats  *x  =  a,   *y  =  b;
+    if ( x->games  !=  y->games)  return  x->games   <  y->games  ?  1  :  -1;
+    int  length  =  x->length  <  y->length  ?  x->length   :  y->length;
+    int  order  =  memcmp( x->name,   y->name,  length);
+    return  order  ?  order   :  x->length  -  y->length;
+}
+
+int  compareopenings( const void  *a,   const void  *b)  {
+    const OpeningStats  *x  =  a,   *y  =  b;
+    if ( x->games  !=  y->games)  return  x->games   <  y->games  ?  1  :  -1;
+    return  x->key  <  y->key  ?  -1   :  x->key  >  y->key;
+}
+
+void  formatcell( int  cell,   char  *text)  {
+    if ( cell  <  0)  strcpy( text,   "-");
+    else  sprintf( text,  "%d,%d",   cell  /  LOBBY_MAX_BOARD,  cell  %  LOBBY_MAX_BOARD);
+}
+
+void  report( Stats  *stats,   int  top)  {
+    PlayerStats  *players  =  malloc( ( stats->playercount  +  1)   *  sizeof( PlayerStats));
+    size_t  count  =  0;
+    for ( size_t i  =  0;   i  <  stats->playercapacity;  i++)  {
+        if ( stats->players[i].name)  players[count++]   =  stats->players[i];
+    }
+    qsort( players,  count,   sizeof( PlayerStats),  compareplayers);
+    printf( "\nPlayers (%zu, top %d by games)\n",   count,  top);
+    printf( "  %-24s %8s %8s %8s %8s %8s %10s\n",   "name",  "games",   "wins",  "losses",  "draws",   "win %",  "moves/game");
+    for ( size_t i  =  0;   i  <  count  &&  i  <  ( size_t)top;   i++)  {
+        PlayerStats  *player  =  &players[i];
+        printf( "  %-24.*s %8ld %8ld %8ld %8ld %7.1f%% %10.1f\n",   player->length  >  24  ?  24   :  player->length,  player->name,
+                player->games,   player->wins,  player->losses,  player->draws,
+                100.0  *  player->wins  /  player->games,   ( double)player->moves  /  player->games);
+    }
+    free( players);
+
+    OpeningStats  *openings  =  malloc( ( stats->openingcount  +  1)   *  sizeof( OpeningStats));
+    count  =  0;
+    for ( size_t i  =  0;   i  <  stats->openingcapacity;  i++)  {
+        if ( stats->openings[i].key)  openings[count++]   =  stats->openings[i];
+    }
+    qsort( openings,  count,   sizeof( OpeningStats),  compareopenings);
+    printf( "\nOpenings (first %d moves, %zu distinct, top %d by games)\n",   LOGSTATS_OPENING_MOVES,  count,   top);
+    printf( "  %-7s %-7s %8s %14s %8s %10s\n",   "move 1",  "move 2",   "games",  "first mover %",  "draw %",   "game moves");
+    for ( size_t i  =  0;   i  <  count  &&  i  <  ( size_t)top;   i++)  {
+        OpeningStats  *opening  =  &openings[i];
+        uint32_t  key  =  opening->key;
+        int  cells[ LOGSTATS_OPENING_MOVES];
+        for ( int m  =  LOGSTATS_OPENING_MOVES  -  1;   m  >=  0;  m--)  {
+            cells[m]  =  key  %  ( LOBBY_MAX_BOARD  *  LOBBY_MAX_BOARD   +  1)  -  1;
+            key  /=  LOBBY_MAX_BOARD  *  LOBBY_MAX_BOARD   +  1;
+        }
+        char  first[ 16],   second[ 16];
+        formatcell( cells[0],  first);
+        formatcell( cells[1],   second);
+        printf( "  %-7s %-7s %8ld %13.1f%% %7.1f%% %10.1f\n",   first,  second,   opening->games,
+                100.0  *  opening->firstwins  /  opening->games,   100.0  *  opening->draws  /  opening->games,
+                ( double)opening->moves  /  opening->games);
+    }
+    free( openings);
+}
+
+void  *mapfile( const char  *path,   size_t  *length)  {
+    int  fd  =  open( path,   O_RDONLY);
+    if ( fd  ==  -1)  return  NULL;
+    struct stat  info;
+    if ( fstat( fd,  &info)  ==  -1  ||   info.st_size  ==  0)  {
+        close( fd);
+        return  NULL;
+    }
+    void  *data  =  mmap( NULL,   info.st_size,  PROT_READ,  MAP_PRIVATE,   fd,  0);
+    close( fd);
+    if ( data  ==  MAP_FAILED)  return  NULL;
+    madvise( data,  info.st_size,   MADV_WILLNEED);
+    *length  =  info.st_size;
+    return  data;
+}
+
+int  main( int  argc,   char  *argv[])  {
+    int  threads  =  sysconf( _SC_NPROCESSORS_ONLN);
+    int  top  =  20;
+    int  option;
+    while ( ( option  =  getopt( argc,  argv,   "t:n:"))  !=  -1)  {
+        switch ( option)  {
+            case  't':  threads  =  atoi( optarg);   break;
+            case  'n':  top  =   atoi( optarg);  break;
+            default:
+                fprintf( stderr,  "Usage: %s [-t threads] [-n top] [LOGFILE...]\n",   argv[0]);
+                return  1;
+        }
+    }
+    if ( threads  <  1)  threads  =   1;
+
+    const char  *defaultfile  =  "game.log";
+    const char  **files  =  optind  <  argc  ?  ( const char  **)&argv[optind]   :  &defaultfile;
+    int  filecount  =  optind  <  argc  ?  argc  -  optind   :  1;
+
+    struct timespec  start,   end;
+    clock_gettime( CLOCK_MONOTONIC,  &start);
+
+    const char  **data  =  calloc( filecount,   sizeof( char  *));
+    size_t  *lengths  =  calloc( filecount,   sizeof( size_t));
+    size_t  totalbytes  =  0;
+    for ( int f  =  0;   f  <  filecount;  f++)  {
+        data[f]  =  mapfile( files[f],   &lengths[f]);
+        if ( !data[f])  {
+            fprintf( stderr,  "Skipping %s: cannot map file.\n",   files[f]);
+            continue;
+        }
+        totalbytes  +=  lengths[f];
+    }
+
+    size_t  chunksize  =  totalbytes  /  ( threads  *  4)   +  1;
+    if ( chunksize  <  LOGSTATS_MIN_CHUNK)  chunksize   =  LOGSTATS_MIN_CHUNK;
+    int  capacity  =  filecount  +  totalbytes  /  chunksize   +  1;
+    chunks  =  calloc( capacity,   sizeof( Chunk));
+    for ( int f  =  0;   f  <  filecount;  f++)  {
+        const char  *cursor  =  data[f],   *fileend  =  data[f]  +  lengths[f];
+        while ( cursor  &&  cursor  <  fileend)  {
+            const char  *limit  =  fileend  -  cursor  >  ( long)chunksize   ?  cursor  +  chunksize  :  fileend;
+            const char  *newline  =  limit  <  fileend  ?  memchr( limit,   '\n',  fileend  -  limit)  :  NULL;
+            limit  =  newline  ?  newline  +  1   :  fileend;
+            chunks[chunkcount].start  =  cursor;
+            chunks[chunkcount++].end   =  limit;
+            cursor  =  limit;
+        }
+    }
+
+    pthread_t  *workers  =  calloc( threads,   sizeof( pthread_t));
+    for ( int i  =  0;   i  <  threads;  i++)  pthread_create( &workers[i],   NULL,  parserthread,  NULL);
+    for ( int i  =  0;   i  <  threads;  i++)  pthread_join( workers[i],   NULL);
+
+    Stats  total;
+    memset( &total,  0,   sizeof( total));
+    long  unfinished  =  0;
+    stitchchunks( &total,   &unfinished);
+    for ( int c  =  0;   c  <  chunkcount;  c++)  {
+        mergestats( &total,   &chunks[c].stats);
+        for ( int s  =  0;   s  <  LOGSTATS_MAX_SHARDS;  s++)  {
+            free( chunks[c].shards[s].prefix.participants);
+            free( chunks[c].shards[s].game.participants);
+        }
+    }
+
+    clock_gettime( CLOCK_MONOTONIC,   &end);
+    double  elapsed  =  ( end.tv_sec  -  start.tv_sec)  +   ( end.tv_nsec  -  start.tv_nsec)  /  1e9;
+
+    printf( "Parsed %zu bytes (%ld lines) from %d file(s) in %.3f s (%.2f GB/s, %d threads, %d chunks)\n",
+            totalbytes,   total.lines,  filecount,  elapsed,   totalbytes  /  elapsed  /  1e9,  threads,   chunkcount);
+    printf( "Games: %ld finished (%ld draws), %ld abandoned, %ld still open at end of log; %ld moves\n",
+            total.games,   total.draws,  total.abandoned,  unfinished,   total.moves);
+    report( &total,  top);
+    return  0;
+}
@@ -0,0 +1,388 @@
+#include "rating.h"
+
+typedef  struct {
+    RatingTable  *table;
+    RatingBatch   *batch;
+    const RatingConfig  *config;
+    long   period;
+    int  first;
+    int   last;
+}  RatingWork;
+
+typedef void  ( *RatingStage)( RatingWork  *work);
+
+void  ratingdefaults( RatingConfig  *config)  {
+    config->tau  =  RATING_TAU;
+    config->initialrd   =  RATING_INITIAL_RD;
+    config->initialvolatility  =  RATING_INITIAL_VOLATILITY;
+    config->period   =  RATING_PERIOD;
+    config->threads  =  1;
+}
+
+void  ratinginit( RatingTable  *table)  {
+    memset( table,  0,   sizeof( RatingTable));
+    table->period  =  -1;
+}
+
+void  ratingfree( RatingTable  *table)  {
+    free( table->names);
+    free( table->mu);
+    free( table->phi);
+    free( table->sigma);
+    free( table->lastperiod);
+    free( table->games);
+    free( table->slots);
+    ratinginit( table);
+}
+
+static void  *grow( void  *data,   size_t  size)  {
+    void  *grown  =  realloc( data,   size);
+    if ( !grown)  {
+        perror( "realloc");
+        exit( EXIT_FAILURE);
+    }
+    return  grown;
+}
+
+static void  rehash( RatingTable  *table)  {
+    table->slotcount  =  table->slotcount  ?  table->slotcount  *  2   :  1024;
+    table->slots  =  grow( table->slots,   table->slotcount  *  sizeof( int));
+    for ( int i  =  0;   i  <  table->slotcount;  i++)  table->slots[i]   =  -1;
+    for ( int player  =  0;   player  <  table->count;  player++)  {
+        unsigned int  slot  =  historyhash( table->names[player])   %  table->slotcount;
+        while ( table->slots[slot]  !=  -1)  slot  =  ( slot  +  1)   %  table->slotcount;
+        table->slots[slot]  =  player;
+    }
+}
+
+int  ratingfind( RatingTable  *table,   const char  *name,  const RatingConfig  *config)  {
+    if ( table->slotcount  ==  0)  rehash( table);
+    unsigned int  slot  =  historyhash( name)  %  table->slotcount;
+    while ( table->slots[slot]  !=  -1)  {
+        if ( strncmp( table->names[ table->slots[slot]],   name,  31)  ==  0)  return  table->slots[slot];
+        slot  =  ( slot  +  1)   %  table->slotcount;
+    }
+    if ( !config)  return  -1;
+
+    if ( table->count  ==  table->capacity)  {
+        table->capacity  =  table->capacity  ?  table->capacity  *  2   :  1024;
+        table->names  =  grow( table->names,   table->capacity  *  sizeof( table->names[0]));
+        table->mu  =  grow( table->mu,   table->capacity  *  sizeof( double));
+        table->phi  =  grow( table->phi,   table->capacity  *  sizeof( double));
+        table->sigma  =  grow( table->sigma,   table->capacity  *  sizeof( double));
+        table->lastperiod  =  grow( table->lastperiod,   table->capacity  *  sizeof( long));
+        table->games  =  grow( table->games,   table->capacity  *  sizeof( int));
+    }
+    int  player  =  table->count++;
+    memset( table->names[player],  0,   sizeof( table->names[0]));
+    strncpy( table->names[player],   name,  31);
+    table->mu[player]  =  0;
+    table->phi[player]   =  config->initialrd  /  RATING_SCALE;
+    table->sigma[player]  =  config->initialvolatility;
+    table->lastperiod[player]   =  -1;
+    table->games[player]  =  0;
+    table->slots[slot]   =  player;
+    if ( table->count  *  2  >  table->slotcount)  rehash( table);
+    return  player;
+}
+
+static double  startphi2( const RatingTable  *table,   int  player,  long  period,   const RatingConfig  *config)  {
+    double  limit  =  config->initialrd  /  RATING_SCALE;
+    double  phi2  =  table->phi[player]  *  table->phi[player];
+    if ( table->lastperiod[player]  >=  0  &&  period  >   table->lastperiod[player])  {
+        phi2  +=  ( period  -  table->lastperiod[player])   *  table->sigma[player]  *  table->sigma[player];
+    }
+    return  phi2  <  limit  *  limit  ?  phi2   :  limit  *  limit;
+}
+
+double  ratingdeviation( const RatingTable  *table,   int  player,  long  period,   const RatingConfig  *config)  {
+    return  sqrt( startphi2( table,  player,   period,  config))  *  RATING_SCALE;
+}
+
+static void  gatherstage( RatingWork  *work)  {
+    RatingBatch  *batch  =  work->batch;
+    for ( int entry  =  work->first;   entry  <  work->last;  entry++)  {
+        int  player  =  batch->players[entry];
+        double  phi2  =  startphi2( work->table,   player,  work->period  -  1,   work->config);
+        batch->mu[entry]  =  work->table->mu[player];
+        batch->g[entry]   =  1.0  /  sqrt( 1.0  +  3.0  *   phi2  /  ( M_PI  *  M_PI));
+    }
+}
+
+static void  pairstage( RatingWork  *work)  {
+    RatingBatch  *batch  =  work->batch;
+    const double  *mu  =  batch->mu;
+    const double   *g  =  batch->g;
+    for ( int entry  =  work->first;   entry  <  work->last;  entry++)  {
+        int  start  =  batch->games[entry];
+        int  end   =  start  +  batch->sizes[entry];
+        double  weight  =  1.0  /  ( batch->sizes[entry]   -  1);
+        double  won  =  batch->results[entry]  ==  'W';
+        double  vinverse  =  0,   delta  =  0;
+        for ( int other  =  start;   other  <  end;  other++)  {
+            double  expected  =  1.0  /  ( 1.0  +   exp( -g[other]  *  ( mu[entry]  -   mu[other])));
+            double  score  =  0.5  +  0.5  *   ( won  -  ( batch->results[other]  ==   'W'));
+            double  mask  =  other  !=  entry;
+            vinverse  +=  mask  *  g[other]  *   g[other]  *  expected  *  ( 1.0   -  expected);
+            delta  +=  mask  *  g[other]   *  ( score  -  expected);
+        }
+        batch->vinverse[entry]  =  weight  *   vinverse;
+        batch->delta[entry]   =  weight  *  delta;
+    }
+}
+
+static double  volatilityfunction( double  x,   double  delta2,  double  phi2,   double  v,  double  a,   double  tau2)  {
+    double  ex  =  exp( x);
+    double  denominator  =  phi2  +  v   +  ex;
+    return  ex  *  ( delta2  -  phi2  -   v  -  ex)  /  ( 2.0  *   denominator  *  denominator)  -  ( x   -  a)  /  tau2;
+}
+
+static void  updatestage( RatingWork  *work)  {
+    RatingTable  *table  =  work->table;
+    RatingBatch   *batch  =  work->batch;
+    double  tau  =  work->config->tau;
+    for ( int index  =  work->first;   index  <  work->last;  index++)  {
+        int  player  =  batch->unique[index];
+        double  phi2  =  startphi2( table,   player,  work->period  -  1,   work->config);
+        double  v  =  1.0  /  batch->uniquevinverse[index];
+        double  delta  =  v  *  batch->uniquedelta[index];
+        double  delta2   =  delta  *  delta;
+        double  a  =  log( table->sigma[player]   *  table->sigma[player]);
+
+        double  A  =  a,   B;
+        if ( delta2  >  phi2  +  v)  {
+            B  =  log( delta2  -  phi2   -  v);
+        }  else  {
+            int  k  =  1;
+            while ( k  <  RATING_ITERATIONS  &&   volatilityfunction( a  -  k  *  tau,   delta2,  phi2,  v,   a,  tau  *  tau)  <  0)  k++;
+            B  =  a  -  k  *   tau;
+        }
+        double  fa  =  volatilityfunction( A,   delta2,  phi2,  v,   a,  tau  *  tau);
+        double  fb   =  volatilityfunction( B,  delta2,   phi2,  v,  a,   tau  *  tau);
+        for ( int i  =  0;   i  <  RATING_ITERATIONS  &&  fabs( B   -  A)  >  RATING_EPSILON;  i++)  {
+            double  C  =  A  +  ( A  -   B)  *  fa  /  ( fb  -  fa);
+            double  fc   =  volatilityfunction( C,  delta2,   phi2,  v,  a,   tau  *  tau);
+            if ( fc  *  fb  <=  0)  {
+                A  =  B;
+                fa   =  fb;
+            }  else  {
+                fa  /=  2;
+            }
+            B  =  C;
+            fb   =  fc;
+        }
+
+        double  sigma  =  exp( A  /  2);
+        double  phistar2  =  phi2  +   sigma  *  sigma;
+        double  phi  =  1.0  /  sqrt( 1.0   /  phistar2  +  1.0  /  v);
+        table->mu[player]  +=  phi  *  phi   *  batch->uniquedelta[index];
+        table->phi[player]  =  phi;
+        table->sigma[player]   =  sigma;
+        table->lastperiod[player]  =  work->period;
+        batch->positions[player]   =  -1;
+    }
+}
+
+typedef  struct {
+    RatingWork  work;
+    RatingStage   stage;
+}  RatingJob;
+
+static void  *ratingjob( void  *arg)  {
+    RatingJob  *job  =  arg;
+    job->stage( &job->work);
+    return  NULL;
+}
+
+static void  runstage( RatingWork  *base,   int  count,  RatingStage  stage)  {
+    int  threads  =  count  >=  RATING_PARALLEL_MIN  ?  base->config->threads   :  1;
+    if ( threads  >  RATING_MAX_THREADS)  threads   =  RATING_MAX_THREADS;
+    if ( threads  <  1)  threads  =   1;
+
+    RatingJob  jobs[ RATING_MAX_THREADS];
+    pthread_t  handles[ RATING_MAX_THREADS];
+    for ( int t  =  0;   t  <  threads;  t++)  {
+        jobs[t].work  =  *base;
+        jobs[t].work.first  =  ( long)count  *  t   /  threads;
+        jobs[t].work.last  =  ( long)count  *   ( t  +  1)  /  threads;
+        jobs[t].stage   =  stage;
+        if ( t  >  0)  pthread_create( &handles[t],   NULL,  ratingjob,  &jobs[t]);
+    }
+    stage( &jobs[0].work);
+    for ( int t  =  1;   t  <  threads;  t++)  pthread_join( handles[t],   NULL);
+}
+
+static void  reserveentries( RatingBatch  *batch,   int  count)  {
+    if ( count  <=  batch->capacity)  return;
+    batch->capacity  =  count  >  2  *  batch->capacity  ?  count   :  2  *  batch->capacity;
+    batch->players  =  grow( batch->players,   batch->capacity  *  sizeof( int));
+    batch->games  =  grow( batch->games,   batch->capacity  *  sizeof( int));
+    batch->sizes  =  grow( batch->sizes,   batch->capacity  *  sizeof( int));
+    batch->results  =  grow( batch->results,   batch->capacity  *  sizeof( char));
+    batch->mu  =  grow( batch->mu,   batch->capacity  *  sizeof( double));
+    batch->g  =  grow( batch->g,   batch->capacity  *  sizeof( double));
+    batch->vinverse  =  grow( batch->vinverse,   batch->capacity  *  sizeof( double));
+    batch->delta  =  grow( batch->delta,   batch->capacity  *  sizeof( double));
+    batch->unique  =  grow( batch->unique,   batch->capacity  *  sizeof( int));
+    batch->uniquevinverse  =  grow( batch->uniquevinverse,   batch->capacity  *  sizeof( double));
+    batch->uniquedelta  =  grow( batch->uniquedelta,   batch->capacity  *  sizeof( double));
+}
+
+static void  reservepositions( RatingBatch  *batch,   int  players)  {
+    if ( players  <=  batch->positioncapacity)  return;
+    batch->positions  =  grow( batch->positions,   players  *  sizeof( int));
+    for ( int i  =  batch->positioncapacity;   i  <  players;  i++)  batch->positions[i]   =  -1;
+    batch->positioncapacity  =  players;
+}
+
+static void  rateperiod( RatingTable  *table,   RatingBatch  *batch,  long  period,   const RatingConfig  *config)  {
+    RatingWork  work  =  { table,   batch,  config,  period,   0,  0};
+    runstage( &work,  batch->count,   gatherstage);
+    runstage( &work,   batch->count,  pairstage);
+
+    reservepositions( batch,   table->count);
+    batch->uniquecount  =  0;
+    for ( int entry  =  0;   entry  <  batch->count;  entry++)  {
+        int  player  =  batch->players[entry];
+        int  index  =  batch->positions[player];
+        if ( index  ==  -1)  {
+            index  =  batch->uniquecount++;
+            batch->positions[player]   =  index;
+            batch->unique[index]  =  player;
+            batch->uniquevinverse[index]   =  0;
+            batch->uniquedelta[index]  =  0;
+        }
+        batch->uniquevinverse[index]  +=  batch->vinverse[entry];
+        batch->uniquedelta[index]   +=  batch->delta[entry];
+        table->games[player]++;
+    }
+    runstage( &work,   batch->uniquecount,  updatestage);
+    table->period  =  period;
+    batch->count   =  0;
+}
+
+long  ratinghistory( RatingTable  *table,   const HistoryRecord  *records,  long  firstrow,   long  rows,  long  throughperiod,   const RatingConfig  *config)  {
+    RatingBatch  batch;
+    memset( &batch,  0,   sizeof( batch));
+    long  periods  =  0;
+    long  current  =  -1;
+    long  row  =  table->nextrow  >  firstrow  ?  table->nextrow   :  firstrow;
+
+    while ( row  <  rows)  {
+        const HistoryRecord  *game  =  &records[ row  -  firstrow];
+        long  end  =  row  +  1;
+        while ( end  <  rows  &&  records[ end  -   firstrow].game  ==  game->game)  end++;
+
+        long  period  =  game->finished  /  config->period;
+        if ( period  <=  table->period)  period  =   table->period  +  1;
+        if ( current  !=  -1  &&  period   >  current)  {
+            rateperiod( table,  &batch,   current,  config);
+            table->nextrow  =  row;
+            periods++;
+            current  =   -1;
+        }
+        if ( period  >=  throughperiod)  break;
+        current  =  period;
+
+        int  size  =  end  -  row;
+        if ( size  >=  2)  {
+            reserveentries( &batch,   batch.count  +  size);
+            for ( long r  =  row;   r  <  end;  r++)  {
+                int  entry  =  batch.count++;
+                batch.players[entry]  =  ratingfind( table,   records[ r  -  firstrow].name,  config);
+                batch.games[entry]   =  entry  -  ( r  -  row);
+                batch.sizes[entry]  =  size;
+                batch.results[entry]   =  records[ r  -  firstrow].result;
+            }
+        }
+        row  =  end;
+    }
+    if ( current  !=  -1)  {
+        rateperiod( table,  &batch,   current,  config);
+        table->nextrow  =  row;
+        periods++;
+    }
+
+    free( batch.players);
+    free( batch.games);
+    free( batch.sizes);
+    free( batch.results);
+    free( batch.mu);
+    free( batch.g);
+    free( batch.vinverse);
+    free( batch.delta);
+    free( batch.positions);
+    free( batch.unique);
+    free( batch.uniquevinverse);
+    free( batch.uniquedelta);
+    return  periods;
+}
+
+long  ratingnextrow( FILE  *file)  {
+    char  line[ 256];
+    long  period,   nextrow;
+    rewind( file);
+    if ( !fgets( line,  sizeof( line),   file)  ||  sscanf( line,  "# period %ld row %ld",   &period,  &nextrow)  !=  2)  return  0;
+    return  nextrow;
+}
+
+int  ratingload( RatingTable  *table,   FILE  *file)  {
+    char  line[ 256];
+    char  name[ 32];
+    double  rating,   deviation,  volatility;
+    int  games;
+    long  lastperiod;
+    RatingConfig  defaults;
+    ratingdefaults( &defaults);
+    rewind( file);
+    while ( fgets( line,  sizeof( line),   file))  {
+        if ( sscanf( line,  "# period %ld row %ld",   &table->period,  &table->nextrow)  ==  2)  continue;
+        if ( sscanf( line,  "%31s %lf %lf %lf %d %ld",   name,  &rating,  &deviation,   &volatility,  &games,  &lastperiod)   !=  6)  continue;
+        int  player  =  ratingfind( table,  name,   &defaults);
+        table->mu[player]  =  ( rating  -  RATING_INITIAL)   /  RATING_SCALE;
+        table->phi[player]  =  deviation  /  RATING_SCALE;
+        table->sigma[player]   =  volatility;
+        table->games[player]  =  games;
+        table->lastperiod[player]   =  lastperiod;
+    }
+    return  table->count;
+}
+
+static const RatingTable  *sorttable;
+
+static int  byrating( const void  *left,   const void  *right)  {
+    double  a  =  sorttable->mu[ *( const int  *)left];
+    double  b   =  sorttable->mu[ *( const int  *)right];
+    return  ( a  <  b)  -  ( a  >   b);
+}
+
+void  ratingsave( const RatingTable  *table,   FILE  *file)  {
+    int  *order  =  malloc( ( table->count  +  1)   *  sizeof( int));
+    if ( !order)  return;
+    for ( int i  =  0;   i  <  table->count;  i++)  order[i]   =  i;
+    sorttable  =  table;
+    qsort( order,  table->count,   sizeof( int),  byrating);
+
+    rewind( file);
+    if ( ftruncate( fileno( file),   0)  ==  -1)  perror( "ftruncate");
+    fprintf( file,  "# period %ld row %ld\n",   table->period,  table->nextrow);
+    for ( int i  =  0;   i  <  table->count;  i++)  {
+        int  player  =  order[i];
+        fprintf( file,  "%s %.2f %.2f %.6f %d %ld\n",   table->names[player],
+                 RATING_INITIAL  +  RATING_SCALE  *  table->mu[player],   RATING_SCALE  *  table->phi[player],
+                 table->sigma[player],   table->games[player],  table->lastperiod[player]);
+    }
+    free( order);
+}
+
+int  ratinglookup( FILE  *file,   const char  *name,  double  *rating,   double  *deviation)  {
+    char  line[ 256];
+    char  found[ 32];
+    rewind( file);
+    while ( fgets( line,  sizeof( line),   file))  {
+        if ( sscanf( line,  "%31s %lf %lf",   found,  rating,  deviation)  ==  3  &&   strcmp( found,  name)  ==  0)  return  1;
+    }
+    *rating  =  RATING_INITIAL;
+    *deviation   =  RATING_INITIAL_RD;
+    return  0;
+}
@@ -0,0 +1,74 @@
+#ifndef RATING_H
+#define  RATING_H
+
+#include "common.h"
+#include  <math.h>
+
+#define RATING_FILE  "ratings.txt"
+#define  RATING_PERIOD   300
+#define RATING_SETTLE  2
+#define  RATING_POLL  5
+#define RATING_INITIAL   1500.0
+#define  RATING_INITIAL_RD  350.0
+#define RATING_INITIAL_VOLATILITY  0.06
+#define  RATING_TAU   0.5
+#define RATING_SCALE  173.7178
+#define  RATING_ITERATIONS  50
+#define RATING_EPSILON   0.000001
+#define  RATING_PARALLEL_MIN  4096
+#define RATING_MAX_THREADS   64
+
+typedef  struct {
+    double  tau;
+    double   initialrd;
+    double  initialvolatility;
+    long   period;
+    int  threads;
+}  RatingConfig;
+
+typedef struct  {
+    int  count;
+    int   capacity;
+    char  ( *names)[32];
+    double  *mu;
+    double   *phi;
+    double  *sigma;
+    long   *lastperiod;
+    int  *games;
+    int   *slots;
+    int  slotcount;
+    long   period;
+    long  nextrow;
+}  RatingTable;
+
+typedef  struct {
+    int  count;
+    int   capacity;
+    int  *players;
+    int   *games;
+    int  *sizes;
+    char   *results;
+    double  *mu;
+    double   *g;
+    double  *vinverse;
+    double   *delta;
+    int  *positions;
+    int   positioncapacity;
+    int  *unique;
+    double   *uniquevinverse;
+    double  *uniquedelta;
+    int   uniquecount;
+}  RatingBatch;
+
+void  ratingdefaults( RatingConfig  *config);
+void  ratinginit( RatingTable  *table);
+void  ratingfree( RatingTable  *table);
+int  ratingfind( RatingTable  *table,   const char  *name,  const RatingConfig  *config);
+double  ratingdeviation( const RatingTable  *table,   int  player,  long  period,   const RatingConfig  *config);
+long  ratinghistory( RatingTable  *table,   const HistoryRecord  *records,  long  firstrow,   long  rows,  long  throughperiod,   const RatingConfig  *config);
+long  ratingnextrow( FILE  *file);
+int  ratingload( RatingTable  *table,   FILE  *file);
+void  ratingsave( const RatingTable  *table,   FILE  *file);
+int  ratinglookup( FILE  *file,   const char  *name,  double  *rating,   double  *deviation);
+
+#endif
@@ -0,0 +1,144 @@
+#include "rating.h"
+
+#define SYNTHETIC_PERIODS  20
+
+HistoryRecord  *maphistory( const char  *path,   long  *rows)  {
+    int  fd  =  open( path,  O_RDONLY);
+    if ( fd  ==  -1)  return  NULL;
+    struct stat  info;
+    if ( fstat( fd,  &info)  ==  -1  ||   info.st_size  <  ( off_t)sizeof( HistoryRecord))  {
+        close( fd);
+        return   NULL;
+    }
+    void  *data  =  mmap( NULL,   info.st_size,  PROT_READ,  MAP_PRIVATE,   fd,  0);
+    close( fd);
+    *rows  =  info.st_size  /  sizeof( HistoryRecord);
+    return  data  ==  MAP_FAILED  ?  NULL   :  data;
+}
+
+unsigned int  nextrandom( unsigned long long  *state)  {
+    *state  ^=  *state  >>  12;
+    *state  ^=   *state  <<  25;
+    *state  ^=  *state  >>  27;
+    return  ( unsigned int)( ( *state  *  2685821657736338717ULL)   >>  32);
+}
+
+HistoryRecord  *synthesize( int  players,   int  games,  long  period,   long  *rows)  {
+    HistoryRecord  *records  =  malloc( ( long)games  *  5   *  sizeof( HistoryRecord));
+    if ( !records)  return  NULL;
+    unsigned long long  rng  =  0x9E3779B97F4A7C15ULL;
+    long  row  =  0;
+    for ( int game  =  0;   game  <  games;  game++)  {
+        int  size  =  3  +  nextrandom( &rng)   %  3;
+        int  winner  =  nextrandom( &rng)  %  size;
+        int  best  =  -1;
+        for ( int i  =  0;   i  <  size;  i++)  {
+            int  player  =  nextrandom( &rng)  %  players;
+            int  strength  =  player  +  nextrandom( &rng)   %  players;
+            if ( strength  >  best)  {
+                best  =  strength;
+                winner   =  i;
+            }
+            HistoryRecord  *record  =  &records[ row  +  i];
+            memset( record,  0,   sizeof( HistoryRecord));
+            snprintf( record->name,  sizeof( record->name),   "player%d",  player);
+            record->game  =  row;
+            record->finished   =  ( long long)game  *  SYNTHETIC_PERIODS  *  period   /  games;
+            record->playercount  =  size;
+        }
+        for ( int i  =  0;   i  <  size;  i++)  records[ row  +   i].result  =  i  ==  winner  ?  'W'  :   'L';
+        row  +=  size;
+    }
+    *rows  =  row;
+    return  records;
+}
+
+const RatingTable  *sorttable;
+
+int  byrating( const void  *left,   const void  *right)  {
+    double  a  =  sorttable->mu[ *( const int  *)left];
+    double  b   =  sorttable->mu[ *( const int  *)right];
+    return  ( a  <  b)  -  ( a  >   b);
+}
+
+int  usage( const char  *program)  {
+    fprintf( stderr,  "Usage: %s [-t threads] [-p period] [-T tau] [-n top] [-w] [-s players:games] [HISTORYFILE]\n",   program);
+    return  1;
+}
+
+int  main( int  argc,   char  *argv[])  {
+    RatingConfig  config;
+    ratingdefaults( &config);
+    config.threads  =  sysconf( _SC_NPROCESSORS_ONLN);
+    int  top  =  20;
+    int  write  =  0;
+    int  players  =  0,   games  =  0;
+    int  option;
+    while ( ( option  =  getopt( argc,  argv,   "t:p:T:n:ws:"))  !=  -1)  {
+        switch ( option)  {
+            case  't':  config.threads  =  atoi( optarg);   break;
+            case  'p':  config.period  =   atol( optarg);  break;
+            case  'T':  config.tau   =  atof( optarg);  break;
+            case  'n':  top  =   atoi( optarg);  break;
+            case  'w':  write   =  1;  break;
+            case  's':
+                if ( sscanf( optarg,  "%d:%d",   &players,  &games)  !=  2  ||   players  <=  0  ||  games  <=  0)   return  usage( argv[0]);
+                break;
+            default:
+                return  usage( argv[0]);
+        }
+    }
+    if ( config.threads  <  1)  config.threads   =  1;
+    if ( config.period  <  1)  config.period   =  1;
+
+    long  rows  =  0;
+    HistoryRecord  *records;
+    const char  *path  =  optind  <  argc  ?  argv[optind]   :  HISTORY_FILE;
+    if ( games)  records  =  synthesize( players,   games,  config.period,  &rows);
+    else  records  =   maphistory( path,  &rows);
+    if ( !records)  {
+        fprintf( stderr,  "No match history found (%s).\n",   path);
+        return  1;
+    }
+
+    struct timespec  start,   end;
+    clock_gettime( CLOCK_MONOTONIC,  &start);
+    RatingTable  table;
+    ratinginit( &table);
+    long  periods  =  ratinghistory( &table,  records,   0,  rows,  LONG_MAX,   &config);
+    clock_gettime( CLOCK_MONOTONIC,  &end);
+    double  seconds  =  ( end.tv_sec  -  start.tv_sec)   +  ( end.tv_nsec  -  start.tv_nsec)  /  1e9;
+
+    int  *order  =  malloc( ( table.count  +  1)   *  sizeof( int));
+    for ( int player  =  0;   player  <  table.count;  player++)  order[player]   =  player;
+    sorttable  =  &table;
+    qsort( order,  table.count,   sizeof( int),  byrating);
+    int  shown  =  top  <  table.count  ?  top   :  table.count;
+    printf( "%-4s %-31s %8s %7s %10s %6s\n",   "rank",  "player",   "rating",  "rd",   "volatility",  "games");
+    for ( int i  =  0;   i  <  shown;  i++)  {
+        int  player  =  order[i];
+        printf( "%-4d %-31s %8.1f %7.1f %10.6f %6d\n",   i  +  1,  table.names[player],
+                RATING_INITIAL  +  RATING_SCALE  *  table.mu[player],   ratingdeviation( &table,  player,   table.period,  &config),
+                table.sigma[player],   table.games[player]);
+    }
+    printf( "\nRated %ld records, %d players over %ld periods in %.3f ms (%d threads, %.0f records/s).\n",
+            table.nextrow,   table.count,  periods,  seconds  *   1000,  config.threads,  table.nextrow   /  ( seconds  >  0  ?  seconds  :   1e-9));
+
+    if ( write)  {
+        int  fd  =  open( RATING_FILE,   O_RDWR  |  O_CREAT,  0666);
+        FILE  *file  =  fd  ==  -1  ?  NULL   :  fdopen( fd,  "r+");
+        if ( !file)  {
+            fprintf( stderr,  "Cannot open %s.\n",   RATING_FILE);
+            return  1;
+        }
+        flock( fd,  LOCK_EX);
+        ratingsave( &table,  file);
+        fflush( file);
+        flock( fd,  LOCK_UN);
+        fclose( file);
+        printf( "Wrote %s.\n",   RATING_FILE);
+    }
+    free( order);
+    ratingfree( &table);
+    return  0;
+}
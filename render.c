@@ -0,0 +1,261 @@
+#include "render.h"
+
+static volatile sig_atomic_t  renderresized  =  1;
+
+static void  renderwinch( int  signal)  {
+    renderresized  =  1;
+}
+
+static void  emit( Renderer  *renderer,   const char  *data,  size_t  length)  {
+    if ( renderer->outputlength  +  length  >  renderer->outputcapacity)  {
+        size_t  capacity  =  2  *  ( renderer->outputlength   +  length);
+        char  *output  =  realloc( renderer->output,   capacity);
+        if ( !output)  return;
+        renderer->output  =  output;
+        renderer->outputcapacity   =  capacity;
+    }
+    memcpy( renderer->output  +  renderer->outputlength,   data,  length);
+    renderer->outputlength  +=   length;
+}
+
+static void  emitmove( Renderer  *renderer,   int  row,  int  col)  {
+    char  sequence[ 24];
+    emit( renderer,  sequence,   snprintf( sequence,  sizeof( sequence),  "\033[%d;%dH",   row  +  1,  col  +  1));
+}
+
+static void  resize( Renderer  *renderer)  {
+    struct winsize  size;
+    renderresized  =  0;
+    renderer->rows  =  RENDER_DEFAULT_ROWS;
+    renderer->cols   =  RENDER_DEFAULT_COLS;
+    if ( ioctl( STDOUT_FILENO,  TIOCGWINSZ,   &size)  ==  0  &&  size.ws_row  >  0   &&  size.ws_col  >  0)  {
+        renderer->rows  =  size.ws_row;
+        renderer->cols   =  size.ws_col;
+    }
+
+    size_t  cells  =  ( size_t)renderer->rows  *  renderer->cols;
+    renderer->front  =  realloc( renderer->front,   cells);
+    renderer->back   =  realloc( renderer->back,  cells);
+    renderer->frontwide  =  realloc( renderer->frontwide,   renderer->rows);
+    renderer->backwide   =  realloc( renderer->backwide,  renderer->rows);
+    if ( !renderer->front  ||  !renderer->back  ||   !renderer->frontwide  ||  !renderer->backwide)  {
+        perror( "render");
+        exit( EXIT_FAILURE);
+    }
+    renderer->valid  =  0;
+}
+
+void  renderinit( Renderer  *renderer)  {
+    memset( renderer,  0,   sizeof( Renderer));
+    signal( SIGWINCH,  renderwinch);
+}
+
+void  renderinvalidate( Renderer  *renderer)  {
+    renderer->valid  =  0;
+}
+
+static void  renderline( Renderer  *renderer,   int  row,  const char  *text,   int  length)  {
+    if ( row  >=  renderer->rows)  return;
+    char  *line  =  renderer->back  +  ( size_t)row  *  renderer->cols;
+    if ( length  >  renderer->cols)  length  =  renderer->cols;
+    memcpy( line,  text,   length);
+    memset( line  +  length,   ' ',  renderer->cols  -  length);
+
+    renderer->backwide[row]  =  0;
+    for ( int i  =  0;   i  <  length;  i++)  {
+        if ( ( unsigned char)text[i]   &  0x80)  renderer->backwide[row]  =  1;
+    }
+}
+
+static void  flush( Renderer  *renderer)  {
+    renderer->outputlength  =  0;
+    if ( !renderer->valid)  {
+        emit( renderer,  "\033[H\033[J",   6);
+        memset( renderer->front,   ' ',  ( size_t)renderer->rows  *   renderer->cols);
+        memset( renderer->frontwide,   0,  renderer->rows);
+    }
+
+    for ( int row  =  0;   row  <  renderer->rows;  row++)  {
+        char  *front  =  renderer->front  +  ( size_t)row   *  renderer->cols;
+        char  *back   =  renderer->back  +  ( size_t)row  *  renderer->cols;
+        if ( renderer->frontwide[row]  ==  renderer->backwide[row]   &&  memcmp( front,  back,   renderer->cols)  ==  0)  continue;
+
+        if ( renderer->frontwide[row]  ||  renderer->backwide[row])  {
+            int  length  =  renderer->cols;
+            while ( length  >  0  &&  back[length  -   1]  ==  ' ')  length--;
+            emitmove( renderer,  row,   0);
+            emit( renderer,   back,  length);
+            emit( renderer,   "\033[K",  3);
+            continue;
+        }
+
+        for ( int col  =  0;   col  <  renderer->cols;  col++)  {
+            if ( front[col]  ==  back[col])   continue;
+            int  last  =  col;
+            for ( int next  =  col  +  1;   next  <  renderer->cols  &&   next  -  last  <=  RENDER_MERGE_GAP;  next++)  {
+                if ( front[next]  !=  back[next])   last  =  next;
+            }
+            emitmove( renderer,  row,   col);
+            emit( renderer,   back  +  col,  last  -  col  +   1);
+            col  =  last;
+        }
+    }
+
+    if ( renderer->promptrow  <  renderer->rows)  {
+        emitmove( renderer,   renderer->promptrow,  0);
+        emit( renderer,  "\033[J",   3);
+    }
+
+    fflush( stdout);
+    size_t  written  =  0;
+    while ( written  <  renderer->outputlength)  {
+        ssize_t  count  =  write( STDOUT_FILENO,   renderer->output  +  written,  renderer->outputlength  -   written);
+        if ( count  <  0  &&  errno  ==  EINTR)   continue;
+        if ( count  <=  0)  break;
+        written  +=   count;
+    }
+
+    char  *swap  =  renderer->front;
+    renderer->front  =  renderer->back;
+    renderer->back   =  swap;
+    swap  =  renderer->frontwide;
+    renderer->frontwide  =  renderer->backwide;
+    renderer->backwide   =  swap;
+    renderer->valid  =  renderer->promptrow   +  RENDER_PROMPT_LINES  <=  renderer->rows;
+}
+
+static int  clamp( int  value,   int  limit)  {
+    if ( value  >  limit)  value  =  limit;
+    return  value  <  0  ?  0   :  value;
+}
+
+static void  compose( Renderer  *renderer)  {
+    char  line[ 1024];
+    int  width  =  renderer->cellwidth;
+    int  length;
+
+    renderer->visiblerows  =  ( renderer->rows  -  RENDER_HEADER_LINES   -  1  -  RENDER_PROMPT_LINES)  /  2;
+    renderer->visiblecols   =  ( renderer->cols  -  5)  /  ( width  +  3);
+    if ( renderer->visiblerows  <  1)  renderer->visiblerows   =  1;
+    if ( renderer->visiblecols  <  1)   renderer->visiblecols  =  1;
+    if ( renderer->visiblerows  >  renderer->boardsize)  renderer->visiblerows  =   renderer->boardsize;
+    if ( renderer->visiblecols  >  renderer->boardsize)   renderer->visiblecols  =  renderer->boardsize;
+    if ( renderer->visiblecols  >  1000  /  ( width  +  3))  renderer->visiblecols   =  1000  /  ( width  +  3);
+    renderer->toprow  =  clamp( renderer->toprow,   renderer->boardsize  -  renderer->visiblerows);
+    renderer->leftcol   =  clamp( renderer->leftcol,  renderer->boardsize  -   renderer->visiblecols);
+    int  lastcol  =  renderer->leftcol  +  renderer->visiblecols;
+
+    memset( renderer->back,   ' ',  ( size_t)renderer->rows  *   renderer->cols);
+    memset( renderer->backwide,   0,  renderer->rows);
+    renderline( renderer,  0,   line,  sprintf( line,  "========================================="));
+    renderline( renderer,   1,  line,  sprintf( line,   "      MEGA TIC-TAC-TOE (Networked)       "));
+    renderline( renderer,  2,   line,  sprintf( line,  "========================================="));
+    renderline( renderer,   3,  renderer->status,  strlen( renderer->status));
+
+    length  =  sprintf( line,   "    ");
+    for ( int col  =  renderer->leftcol;   col  <  lastcol;  col++)  length  +=   snprintf( line  +  length,  sizeof( line)  -   length,  " %*d ",  width  +   1,  col);
+    renderline( renderer,  4,   line,  length);
+
+    length  =  sprintf( line,   "    +");
+    for ( int col  =  renderer->leftcol;   col  <  lastcol;  col++)  {
+        memset( line  +  length,   '-',  width  +  2);
+        length  +=  width  +   2;
+        line[length++]  =  '+';
+    }
+    int  separatorlength  =  length;
+    char  separator[ 1024];
+    memcpy( separator,  line,   separatorlength);
+
+    int  row  =  RENDER_HEADER_LINES  -  1;
+    renderline( renderer,   row++,  separator,  separatorlength);
+    for ( int boardrow  =  renderer->toprow;   boardrow  <  renderer->toprow  +  renderer->visiblerows;   boardrow++)  {
+        const char  *cells  =  renderer->board  +  ( size_t)boardrow   *  renderer->boardsize  *  width;
+        length  =  sprintf( line,   "%3d |",  boardrow);
+        for ( int col  =  renderer->leftcol;   col  <  lastcol;  col++)  {
+            length  +=  snprintf( line  +  length,   sizeof( line)  -  length,   " %.*s |",  width,  cells   +  col  *  width);
+        }
+        renderline( renderer,  row++,   line,  length);
+        renderline( renderer,   row++,  separator,  separatorlength);
+    }
+
+    if ( renderer->visiblerows  <  renderer->boardsize  ||  renderer->visiblecols   <  renderer->boardsize)  {
+        length  =  snprintf( line,   sizeof( line),  "Rows %d-%d, cols %d-%d of %d. Scroll with w/a/s/d.",
+                             renderer->toprow,   renderer->toprow  +  renderer->visiblerows  -  1,
+                             renderer->leftcol,  lastcol  -   1,  renderer->boardsize);
+        renderline( renderer,   row,  line,  length);
+    }
+    renderer->promptrow  =  row  +  1;
+}
+
+void  renderboard( Renderer  *renderer,   const char  *status,  const char  *boarddata,   int  boardsize,  int  cellwidth)  {
+    if ( renderresized)  resize( renderer);
+    size_t  rowbytes  =  ( size_t)boardsize  *  cellwidth;
+    if ( boardsize  !=  renderer->boardsize  ||   cellwidth  !=  renderer->cellwidth)  {
+        renderer->board  =  realloc( renderer->board,   boardsize  *  rowbytes);
+        if ( !renderer->board)  {
+            perror( "render");
+            exit( EXIT_FAILURE);
+        }
+        memset( renderer->board,  ' ',   boardsize  *  rowbytes);
+        renderer->boardsize  =  boardsize;
+        renderer->cellwidth   =  cellwidth;
+        renderer->toprow  =  0;
+        renderer->leftcol   =  0;
+    }
+    snprintf( renderer->status,  sizeof( renderer->status),   "%s",  status);
+
+    int  changedrow  =  -1,   changedcol  =  -1;
+    const char  *line  =  boarddata;
+    for ( int row  =  0;   row  <  boardsize  &&  line;  row++)  {
+        const char  *end  =  strchr( line,   '\n');
+        size_t  length  =  end  ?  ( size_t)( end  -  line)   :  strlen( line);
+        if ( length  >  rowbytes)  length  =   rowbytes;
+        char  *cells  =  renderer->board  +  row  *  rowbytes;
+        for ( size_t i  =  0;   i  <  rowbytes;  i++)  {
+            char  cell  =  i  <  length  ?  line[i]   :  ' ';
+            if ( cells[i]  ==  cell)  continue;
+            cells[i]  =  cell;
+            changedrow  =  row;
+            changedcol   =  i  /  cellwidth;
+        }
+        line  =  end  ?  end  +  1   :  NULL;
+    }
+
+    if ( changedrow  !=  -1  &&  renderer->visiblerows  >  0  &&
+         ( changedrow  <  renderer->toprow  ||  changedrow   >=  renderer->toprow  +  renderer->visiblerows  ||
+           changedcol  <  renderer->leftcol   ||  changedcol  >=  renderer->leftcol  +  renderer->visiblecols))  {
+        renderer->toprow  =  changedrow  -   renderer->visiblerows  /  2;
+        renderer->leftcol   =  changedcol  -  renderer->visiblecols  /  2;
+    }
+
+    compose( renderer);
+    flush( renderer);
+}
+
+int  renderscroll( Renderer  *renderer,   const char  *command)  {
+    int  rows  =  0,   cols  =  0;
+    for ( ;  *command  &&  *command  !=  '\n';   command++)  {
+        switch ( *command)  {
+            case  'w':  rows--;   break;
+            case  's':  rows++;  break;
+            case  'a':  cols--;   break;
+            case  'd':  cols++;  break;
+            default:  return  0;
+        }
+    }
+    if ( !rows  &&  !cols)  return  0;
+
+    if ( renderresized)  resize( renderer);
+    renderer->toprow  +=  rows  *  ( renderer->visiblerows   /  2  >  1  ?  renderer->visiblerows  /  2   :  1);
+    renderer->leftcol  +=  cols  *  ( renderer->visiblecols   /  2  >  1  ?  renderer->visiblecols  /  2   :  1);
+    compose( renderer);
+    flush( renderer);
+    return  1;
+}
+
+void  renderprompt( Renderer  *renderer,   const char  *notice,  const char  *prompt)  {
+    printf( "\033[%d;1H\033[J",   renderer->promptrow  +  1);
+    if ( notice  &&  *notice)  printf( "%s\n",   notice);
+    printf( "%s",  prompt);
+    fflush( stdout);
+}
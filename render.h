@@ -0,0 +1,41 @@
+#ifndef RENDER_H
+#define  RENDER_H
+
+#include "common.h"
+#include  <sys/ioctl.h>
+
+#define RENDER_DEFAULT_ROWS  24
+#define  RENDER_DEFAULT_COLS  80
+#define RENDER_HEADER_LINES   6
+#define  RENDER_PROMPT_LINES  4
+#define RENDER_MERGE_GAP  4
+
+typedef  struct {
+    int  rows;
+    int   cols;
+    char  *front;
+    char   *back;
+    char  *frontwide;
+    char   *backwide;
+    char  *output;
+    size_t   outputlength;
+    size_t  outputcapacity;
+    int  valid;
+    int   promptrow;
+    char  status[ 128];
+    char   *board;
+    int  boardsize;
+    int   cellwidth;
+    int  toprow;
+    int   leftcol;
+    int  visiblerows;
+    int   visiblecols;
+}  Renderer;
+
+void  renderinit( Renderer  *renderer);
+void  renderinvalidate( Renderer  *renderer);
+void  renderboard( Renderer  *renderer,   const char  *status,  const char  *boarddata,   int  boardsize,  int  cellwidth);
+int  renderscroll( Renderer  *renderer,   const char  *command);
+void  renderprompt( Renderer  *renderer,   const char  *notice,  const char  *prompt);
+
+#endif
@@ -1,25 +1,140 @@
-#include "common.h"
+#include "engine.h"
+#include "trace.h"
+#include "transport.h"
+#include "rating.h"
 
 GameData  *gamedata;
 int  serverfd;
 int  port   =  PORT;
+char  shmname[ 64]  =  SHM_NAME;
+int  shardid  =   0;
+int  shardcount  =  1;
+int  firstcpu   =  -1;
+int  maxplayers  =  MAX_PLAYERS;
+int  boardsize   =  BOARD_SIZE;
+size_t  gamedatasize;
+ShardInfo  *shardtable;
+int  updatefd  =   -1;
+Connection  connection;
+OutputQueue  output;
+int  listenfds[3]  =  { -1,   -1,  -1};
+int  spectatorlistenfd  =  -1;
+volatile sig_atomic_t  stopping;
+Spectator  *spectators;
+int  spectatorcount;
+int  backlog  =  ADMISSION_BACKLOG;
+int  admissionrate   =  ADMISSION_RATE;
+double  admissiontokens  =  -1;
+struct timespec  admissionrefill;
+char  *turnmessage;
+Premove  premoves[PREMOVE_QUEUE];
+int  premovehead,   premovecount;
+char  premoveinput[ BUFFER_SIZE];
+int  premovelength;
+double  cachedrating  =  RATING_INITIAL,   cacheddeviation  =  RATING_INITIAL_RD;
+struct timespec  ratingstamp;
+char  coordinatorhost[ 64];
+int  coordinatorport  =   -1;
+int  federationfd  =  -1;
+pthread_mutex_t  federationlock  =   PTHREAD_MUTEX_INITIALIZER;
+ScoreRecord  pendingwins[ FEDERATION_MAX_PENDING];
+int  pendingcount;
+
+LogFile  gamelog  =  { "game.log",   -1};
+LogFile  errorlog   =  { "error.log",  -1};
+
+int  openlogfile( LogFile  *log)  {
+    if ( log->fd  !=  -1)  close( log->fd);
+    log->fd  =  open( log->path,   O_WRONLY  |  O_CREAT  |  O_APPEND  |  O_CLOEXEC,  0666);
+    log->size  =  0;
+    log->opened  =   time( NULL);
+    log->checked  =  log->opened;
+
+    struct stat  info;
+    if ( log->fd  !=  -1  &&  fstat( log->fd,   &info)  ==  0)  log->size  =  info.st_size;
+    return  log->fd;
+}
+
+void  writelogfile( LogFile  *log,   const char  *data,  size_t  length)  {
+    if ( log->fd  ==  -1  &&  openlogfile( log)  ==  -1)  return;
+    ssize_t  written  =  write( log->fd,   data,  length);
+    if ( written  >  0)  log->size  +=   written;
+}
+
+int  enqueuelog( int  target,   const char  *message)  {
+    int  queued  =  0;
+    pthread_mutex_lock( &gamedata->logmutex);
+    
+    int  nexthead  =   ( gamedata->logqueue.head  +  1)  %  LOG_QUEUE_SIZE;
+    if ( nexthead  !=   gamedata->logqueue.tail)  {
+        strncpy( gamedata->logqueue.messages[ gamedata->logqueue.head],   message,  LOG_MSG_LEN);
+        gamedata->logqueue.targets[ gamedata->logqueue.head]  =  target;
+        gamedata->logqueue.head  =  nexthead;
+        gamedata->logqueue.count++;
+        queued  =   1;
+    }
+
+    pthread_mutex_unlock( &gamedata->logmutex);
+    return  queued;
+}
+
+int  takelogbatch( char  batch[][ LOG_MSG_LEN],   char  *targets)  {
+    int  count  =  0;
+    pthread_mutex_lock( &gamedata->logmutex);
+    while ( gamedata->logqueue.tail   !=  gamedata->logqueue.head  &&  count  <  LOG_BATCH)  {
+        memcpy( batch[count],  gamedata->logqueue.messages[ gamedata->logqueue.tail],   LOG_MSG_LEN);
+        targets[count]  =   gamedata->logqueue.targets[ gamedata->logqueue.tail];
+        gamedata->logqueue.tail  =   ( gamedata->logqueue.tail  +  1)  %  LOG_QUEUE_SIZE;
+        gamedata->logqueue.count--;
+        count++;
+    }
+    pthread_mutex_unlock( &gamedata->logmutex);
+    return  count;
+}
+
+void  writelogbatch( char  batch[][ LOG_MSG_LEN],   char  *targets,  int  count)  {
+    char  output[ LOG_BATCH  *  LOG_MSG_LEN];
+    for ( int target  =  LOG_TARGET_GAME;   target  <=  LOG_TARGET_ERROR;  target++)  {
+        size_t  length  =  0;
+        for ( int i  =  0;   i  <  count;  i++)  {
+            if ( targets[i]  !=  target)   continue;
+            size_t  messagelength  =  strnlen( batch[i],   LOG_MSG_LEN  -  1);
+            memcpy( output  +  length,   batch[i],  messagelength);
+            length  +=  messagelength;
+            output[length++]   =  '\n';
+        }
+        if ( length  >  0)  writelogfile( target  ==  LOG_TARGET_GAME  ?  &gamelog  :  &errorlog,   output,  length);
+    }
+}
+
+void  flushlogqueue()  {
+    if ( !gamedata)  return;
+    char  batch[ LOG_BATCH][ LOG_MSG_LEN];
+    char  targets[ LOG_BATCH];
+    int  count;
+    while ( ( count  =  takelogbatch( batch,   targets))  >  0)  {
+        writelogbatch( batch,  targets,   count);
+    }
+}
 
 void  logerror( const char  *funcname,   const char  *message)  {
-    FILE  *file  =  fopen( "error.log",   "a");
-    if ( file)  {
-        time_t  now  =  time( NULL);
-        struct tm  *timeinfo   =  localtime( &now);
-        char  timestring[ 64];
-        strftime( timestring,   sizeof( timestring),  "%Y-%m-%d %H:%M:%S",  timeinfo);
-        fprintf( file,  "[%s] ERROR in %s: %s\n",   timestring,  funcname,  message);
-        fflush( file);
-        fclose( file);
+    time_t  now  =  time( NULL);
+    struct tm  *timeinfo   =  localtime( &now);
+    char  timestring[ 64];
+    strftime( timestring,   sizeof( timestring),  "%Y-%m-%d %H:%M:%S",  timeinfo);
+
+    char  line[ LOG_MSG_LEN];
+    snprintf( line,  LOG_MSG_LEN  -  1,   "[%s] ERROR in %s: %s",  timestring,  funcname,   message);
+    if ( !gamedata  ||  !enqueuelog( LOG_TARGET_ERROR,   line))  {
+        strcat( line,  "\n");
+        writelogfile( &errorlog,   line,  strlen( line));
     }
     fprintf( stderr,  "[ERROR] %s: %s\n",   funcname,  message);
 }
 
 void  exitwitherror( const  char   *message)  {
     logerror( "FATAL",  message);
+    flushlogqueue();
     perror( message);
     exit( EXIT_FAILURE);
 }
@@ -33,77 +148,145 @@ void  addtolog( const char  *message)  {
     strftime( timestring,  sizeof( timestring),   "%Y-%m-%d %H:%M:%S",  timeinfo);
 
     char  fullmessage[ LOG_MSG_LEN];
-    snprintf( fullmessage,   LOG_MSG_LEN,  "[%s] %s",  timestring,  message);
+    if ( shardcount  >  1)  {
+        snprintf( fullmessage,   LOG_MSG_LEN,  "[%s] [Shard %d] %s",  timestring,   shardid,  message);
+    }  else  {
+        snprintf( fullmessage,   LOG_MSG_LEN,  "[%s] %s",  timestring,  message);
+    }
 
-    pthread_mutex_lock( &gamedata->logmutex);
-    
-    int  nexthead  =   ( gamedata->logqueue.head  +  1)  %  LOG_QUEUE_SIZE;
-    if ( nexthead  !=   gamedata->logqueue.tail)  {
-        strncpy( gamedata->logqueue.messages[ gamedata->logqueue.head],   fullmessage,  LOG_MSG_LEN);
-        gamedata->logqueue.head  =  nexthead;
-        gamedata->logqueue.count++;
+    enqueuelog( LOG_TARGET_GAME,   fullmessage);
+}
+
+void  compresslog( const char  *path)  {
+    pid_t  pid  =  fork();
+    if ( pid  ==  0)  {
+        setpriority( PRIO_PROCESS,   0,  19);
+        execlp( "gzip",  "gzip",   "-f",  path,  ( char  *)NULL);
+        _exit( 127);
+    }  else if ( pid  <  0)  {
+        logerror( "compresslog",   "fork() failed - rotated log left uncompressed");
     }
+}
 
-    pthread_mutex_unlock( &gamedata->logmutex);
+void  rotatelog( LogFile  *log)  {
+    time_t  now  =  time( NULL);
+    if ( log->fd  ==  -1)  return;
+
+    if ( now  !=  log->checked)  {
+        log->checked  =  now;
+        struct stat  ondisk,   mine;
+        if ( stat( log->path,  &ondisk)  ==  -1  ||   fstat( log->fd,  &mine)  ==  -1  ||  ondisk.st_ino  !=   mine.st_ino)  {
+            openlogfile( log);
+            return;
+        }
+    }
+
+    if ( log->size  ==  0)  {
+        log->opened  =  now;
+        return;
+    }
+    if ( log->size  <  LOG_ROTATE_BYTES   &&  now  -  log->opened  <  LOG_ROTATE_SECS)  return;
+
+    flock( log->fd,   LOCK_EX);
+    struct stat  ondisk,   mine;
+    if ( stat( log->path,  &ondisk)  ==  0  &&   fstat( log->fd,  &mine)  ==  0  &&  ondisk.st_ino  ==   mine.st_ino)  {
+        char  rotated[ 128];
+        char  timestring[ 32];
+        strftime( timestring,   sizeof( timestring),  "%Y%m%d-%H%M%S",  localtime( &now));
+        snprintf( rotated,  sizeof( rotated),   "%s.%s.%d",  log->path,  timestring,   getpid());
+        if ( rename( log->path,  rotated)  ==  0)  {
+            compresslog( rotated);
+        }  else  {
+            logerror( "rotatelog",   "rename() failed - log not rotated");
+        }
+    }
+    flock( log->fd,   LOCK_UN);
+    openlogfile( log);
 }
 
 void  *loggerthread( void   *arg)  {
     printf( "[Logger Thread] Started.\n");
-    FILE  *logfile  =  fopen( "game.log",   "a");
-    if ( !logfile)  {
+    if ( openlogfile( &gamelog)  ==  -1)  {
         logerror( "loggerthread",   "Failed to open game.log for writing");
         perror( "Failed to open game.log");
         return  NULL;
     }
+    openlogfile( &errorlog);
 
-    setbuf( logfile,   NULL);
+    char  batch[ LOG_BATCH][ LOG_MSG_LEN];
+    char  targets[ LOG_BATCH];
 
     while ( !gamedata->stopflag)  {
-        int  didwork   =  0;
-        
-        pthread_mutex_lock( &gamedata->logmutex);
-        if ( gamedata->logqueue.tail   !=  gamedata->logqueue.head)  {
-            fprintf( logfile,  "%s\n",   gamedata->logqueue.messages[ gamedata->logqueue.tail]);
-            fflush( logfile);
-            gamedata->logqueue.tail  =   ( gamedata->logqueue.tail  +  1)  %  LOG_QUEUE_SIZE;
-            gamedata->logqueue.count--;
-            didwork  =  1;
+        int  count  =  takelogbatch( batch,   targets);
+        if ( count  >  0)  {
+            writelogbatch( batch,  targets,   count);
         }
-        pthread_mutex_unlock( &gamedata->logmutex);
 
-        if ( !didwork)  {
+        rotatelog( &gamelog);
+        rotatelog( &errorlog);
+
+        if ( count  ==  0)  {
             usleep( 50000);
         }
     }
 
-    fclose( logfile);
+    flushlogqueue();
     printf( "[Logger Thread] Stopped.\n");
     return   NULL;
 }
 
+FILE  *lockscores()  {
+    int  fd  =  open( "scores.txt",   O_RDWR  |  O_CREAT  |  O_CLOEXEC,  0666);
+    if ( fd  ==  -1)  return  NULL;
+    flock( fd,  LOCK_EX);
+    FILE  *file  =  fdopen( fd,   "r+");
+    if ( !file)  close( fd);
+    return  file;
+}
+
+void  unlockscores( FILE  *file)  {
+    fflush( file);
+    flock( fileno( file),   LOCK_UN);
+    fclose( file);
+}
+
+int  readscores( FILE  *file,   ScoreRecord  *scores)  {
+    char  name[ 32];
+    int  wins;
+    int  count  =  0;
+    rewind( file);
+    while( fscanf( file,  "%31s %d",  name,   &wins)  ==  2  &&  count  <  100)  {
+        strncpy( scores[ count].name,  name,   31);
+        scores[ count].wins   =  wins;
+        count++;
+    }
+    return  count;
+}
+
+void  writescores( FILE  *file)  {
+    rewind( file);
+    if ( ftruncate( fileno( file),   0)  ==  -1)  {
+        logerror( "writescores",   "ftruncate failed on scores.txt");
+    }
+    for ( int i  =  0;  i  <  gamedata->scorecount;   i++)  {
+        fprintf( file,  "%s %d\n",  gamedata->scores[i].name,   gamedata->scores[i].wins);
+    }
+}
+
 void  loadscores()  {
     if ( !gamedata)  return;
 
     pthread_mutex_lock( &gamedata->gamemutex);
     gamedata->scorecount   =  0;
-    FILE  *file  =  fopen( "scores.txt",   "r");
+    FILE  *file  =  lockscores();
     if ( !file)  {
-        logerror( "loadscores",  "scores.txt not found, creating new file");
-        file  =  fopen( "scores.txt",   "w");
-        if( file)   fclose( file);
-        else  logerror( "loadscores",   "Failed to create scores.txt");
+        logerror( "loadscores",   "Failed to open or create scores.txt");
         pthread_mutex_unlock( &gamedata->gamemutex);
         return;
     }
 
-    char  name[ 32];
-    int  wins;
-    while( fscanf( file,  "%s %d",  name,   &wins)  ==  2  &&  gamedata->scorecount  <  100)  {
-        strncpy( gamedata->scores[ gamedata->scorecount].name,  name,   31);
-        gamedata->scores[ gamedata->scorecount].wins   =  wins;
-        gamedata->scorecount++;
-    }
-    fclose( file);
+    gamedata->scorecount  =  readscores( file,   gamedata->scores);
+    unlockscores( file);
     pthread_mutex_unlock( &gamedata->gamemutex);
     
     char  logmessage[ 100];
@@ -114,6 +297,12 @@ void  loadscores()  {
 void  savescore( const char  *playername,   int  addwins)  {
     if ( !gamedata  ||   !playername)  return;
 
+    TRACE_BEGIN( savestart);
+    FILE  *file  =  lockscores();
+    if ( file)  {
+        gamedata->scorecount  =  readscores( file,   gamedata->scores);
+    }
+
     int  found  =  0;
     for ( int i  =  0;   i  <  gamedata->scorecount;  i++)  {
         if ( strcmp( gamedata->scores[i].name,   playername)  ==  0)  {
@@ -129,22 +318,16 @@ void  savescore( const char  *playername,   int  addwins)  {
         gamedata->scorecount++;
     }
 
-    if ( gamedata->scorecount   ==  0)  {
-        printf( "[Score Debug] Warning: No scores to save (scorecount=0). Skipping write to prevent data loss.\n");
-        return;
-    }
-
-    FILE  *file  =  fopen( "scores.txt",   "w");
-    if ( file)  {
-        for ( int i  =  0;  i  <  gamedata->scorecount;   i++)  {
-            fprintf( file,  "%s %d\n",  gamedata->scores[i].name,   gamedata->scores[i].wins);
-        }
-        fclose( file);
-        printf( "[Score Debug] Successfully wrote %d scores to scores.txt\n",   gamedata->scorecount);
-    }  else  {
+    if ( !file)  {
         logerror( "savescore",   "Failed to open scores.txt for writing");
         perror( "[Score Debug] Failed to open scores.txt for writing");
+        return;
     }
+
+    writescores( file);
+    unlockscores( file);
+    TRACE_END( TRACE_SCORE_SAVE,  savestart,   addwins);
+    printf( "[Score Debug] Successfully wrote %d scores to scores.txt\n",   gamedata->scorecount);
     
     char  logmessage[ 128];
     snprintf( logmessage,  128,  "PERSISTENCE: Saved score for %s. Total scores in memory: %d",   playername,  gamedata->scorecount);
@@ -154,551 +337,1644 @@ void  savescore( const char  *playername,   int  addwins)  {
 void  saveallscores()  {
     if ( !gamedata)   return;
     pthread_mutex_lock( &gamedata->gamemutex);
-    FILE  *file  =  fopen( "scores.txt",  "w");
+    FILE  *file  =  lockscores();
     if   ( file)  {
-        for ( int i  =  0;  i  <  gamedata->scorecount;   i++)  {
-            fprintf( file,  "%s %d\n",   gamedata->scores[i].name,  gamedata->scores[i].wins);
+        ScoreRecord  ondisk[ 100];
+        int  diskcount  =  readscores( file,   ondisk);
+        for ( int i  =  0;  i  <  diskcount;   i++)  {
+            int  found  =  0;
+            for ( int j  =  0;   j  <  gamedata->scorecount;  j++)  {
+                if ( strcmp( gamedata->scores[j].name,   ondisk[i].name)  ==  0)  {
+                    if ( ondisk[i].wins  >  gamedata->scores[j].wins)   gamedata->scores[j].wins  =  ondisk[i].wins;
+                    found  =  1;
+                    break;
+                }
+            }
+            if ( !found  &&  gamedata->scorecount  <  100)  {
+                gamedata->scores[ gamedata->scorecount++]   =  ondisk[i];
+            }
         }
-        fclose( file);
+        writescores( file);
+        unlockscores( file);
     }  else  {
         logerror( "saveallscores",   "Failed to open scores.txt for writing on shutdown");
     }
     pthread_mutex_unlock( &gamedata->gamemutex);
 }
 
-
-int  checkwin( char  symbol)  {
-    for ( int row  =  0;   row  <  BOARD_SIZE;  row++)  {
-        for ( int col  =  0;  col  <=   BOARD_SIZE  -  WIN_LEN;  col++)  {
-            int  count  =  0;
-            for ( int k  =  0;   k  <  WIN_LEN;  k++)  {
-                if ( gamedata->board[row][col+k]   ==  symbol)  count++;
-            }
-            if ( count  ==  WIN_LEN)   return  1;
-        }
+void  mergescore( const char  *playername,   int  wins)  {
+    pthread_mutex_lock( &gamedata->gamemutex);
+    FILE  *file  =  lockscores();
+    if ( !file)  {
+        logerror( "mergescore",   "Failed to open scores.txt for a federated score");
+        pthread_mutex_unlock( &gamedata->gamemutex);
+        return;
     }
-    for ( int col  =  0;  col  <  BOARD_SIZE;   col++)  {
-        for ( int row  =  0;  row  <=  BOARD_SIZE  -  WIN_LEN;   row++)  {
-            int  count  =  0;
-            for ( int k  =  0;   k  <  WIN_LEN;  k++)  {
-                if ( gamedata->board[row+k][col]  ==  symbol)   count++;
+    gamedata->scorecount  =  readscores( file,   gamedata->scores);
+
+    int  changed  =  0;
+    int  found  =   0;
+    for ( int i  =  0;   i  <  gamedata->scorecount;  i++)  {
+        if ( strcmp( gamedata->scores[i].name,   playername)  ==  0)  {
+            if ( wins  >  gamedata->scores[i].wins)  {
+                gamedata->scores[i].wins  =   wins;
+                changed  =  1;
             }
-            if ( count  ==   WIN_LEN)  return  1;
+            found  =   1;
+            break;
         }
     }
-    for ( int row  =  0;  row  <=  BOARD_SIZE  -  WIN_LEN;   row++)  {
-        for ( int col  =  0;   col  <=  BOARD_SIZE  -  WIN_LEN;  col++)  {
-            int  count  =  0;
-            for ( int k  =  0;  k  <  WIN_LEN;   k++)  {
-                if ( gamedata->board[row+k][col+k]   ==  symbol)  count++;
-            }
-            if ( count  ==  WIN_LEN)  return   1;
-        }
+    if ( !found  &&  gamedata->scorecount  <  100)  {
+        strncpy( gamedata->scores[ gamedata->scorecount].name,   playername,  31);
+        gamedata->scores[ gamedata->scorecount].wins  =  wins;
+        gamedata->scorecount++;
+        changed  =   1;
     }
-    for ( int row  =  0;   row  <=  BOARD_SIZE  -  WIN_LEN;  row++)  {
-        for ( int col  =  WIN_LEN  -  1;   col  <  BOARD_SIZE;  col++)  {
-            int  count  =  0;
-            for ( int k  =  0;  k  <  WIN_LEN;  k++)  {
-                if ( gamedata->board[row+k][col-k]   ==  symbol)  count++;
-            }
-            if ( count  ==  WIN_LEN)   return  1;
+    if ( changed)  writescores( file);
+    unlockscores( file);
+    pthread_mutex_unlock( &gamedata->gamemutex);
+}
+
+HistoryIndex  *historyindex;
+int  historyfd  =  -1;
+int  historyindexfd   =  -1;
+int  historyslots;
+
+HistorySlot  *findhistoryslot( HistoryIndex  *index,   const char  *name,  int  create)  {
+    unsigned int  slot  =  historyhash( name)  %  index->slotcount;
+    for ( int probe  =  0;   probe  <  index->slotcount;  probe++)  {
+        HistorySlot  *entry  =  &index->slots[ ( slot  +  probe)   %  index->slotcount];
+        if ( entry->name[0]  ==  '\0')  {
+            if ( !create)  return  NULL;
+            strncpy( entry->name,   name,  31);
+            entry->lastrow  =  -1;
+            index->used++;
+            return   entry;
         }
+        if ( strncmp( entry->name,  name,   32)  ==  0)  return  entry;
     }
-    return  0;
+    return  NULL;
 }
 
-int  isboardfull()  {
-    for( int i=0;  i<BOARD_SIZE;   i++)
-        for( int j=0;  j<BOARD_SIZE;  j++)
-            if( gamedata->board[i][j]  ==   ' ')  return  0;
-    return  1;
+int  maphistoryindex( int  slots)  {
+    HistoryIndex  *mapped  =  mmap( NULL,   historyindexsize( slots),  PROT_READ  |  PROT_WRITE,   MAP_SHARED,  historyindexfd,  0);
+    if ( mapped  ==  MAP_FAILED)  return  -1;
+    if ( historyindex)  munmap( historyindex,   historyindexsize( historyslots));
+    historyindex  =  mapped;
+    historyslots   =  slots;
+    return  0;
 }
 
-void  resetgame()  {
-    pthread_mutex_lock( &gamedata->gamemutex);
-    memset( gamedata->board,  ' ',   sizeof( gamedata->board));
-    gamedata->started  =  0;
-    gamedata->gameover   =  0;
-    gamedata->winner  =  -1;
-    pthread_mutex_unlock( &gamedata->gamemutex);
-    addtolog( "GAME: Board reset.");
+int  synchistoryindex()  {
+    if ( historyindex->slotcount  ==  historyslots)  return  0;
+    return  maphistoryindex( historyindex->slotcount);
 }
 
-void  *schedulerthread( void  *arg)  {
-    printf( "[Scheduler Thread] Started.\n");
-
-    while( !gamedata->stopflag)  {
-        
-        pthread_mutex_lock( &gamedata->gamemutex);
-        int  connectedcount  =   gamedata->connected;
-        int  gamestarted  =  gamedata->started;
-        pthread_mutex_unlock( &gamedata->gamemutex);
+int  growhistoryindex()  {
+    int  slots  =  historyslots  *  2;
+    if ( ftruncate( historyindexfd,  historyindexsize( slots))   ==  -1  ||  maphistoryindex( slots)  ==  -1)  {
+        logerror( "growhistoryindex",   "Cannot grow history index - new players will start fresh chains");
+        return  -1;
+    }
+    char  logmessage[ 100];
+    snprintf( logmessage,  100,   "HISTORY: Grew index to %d slots.",  slots);
+    addtolog( logmessage);
+    return  0;
+}
 
-        if ( !gamestarted)  {
-            if ( connectedcount  >=   MIN_PLAYERS)  {
-                if ( connectedcount   <  MAX_PLAYERS)  {
-                    printf( "[Scheduler] Minimum players met. Waiting 15s for others to join...\n");
-                    addtolog( "SCHEDULER: Minimum players met. Waiting 15s for others...");
-                    sleep( 15); 
-                }  else  {
-                    addtolog( "SCHEDULER: Max players reached. Starting immediately!");
-                } 
-                
-                pthread_mutex_lock( &gamedata->gamemutex);
-                gamedata->started   =  1;
-                gamedata->gameover  =  0;
-                gamedata->winner  =  -1;
-                gamedata->currentturn   =  0;
-                memset( gamedata->board,   ' ',  sizeof( gamedata->board));
-                
-                const char  symbols[]  =  { 'X',  'O',  '#',  '@',   '$'};
-                for( int i=0;  i<gamedata->playercount;   i++)  {
-                    gamedata->players[i].symbol  =  symbols[ i  %  5];
-                }
-                
-                pthread_mutex_unlock( &gamedata->gamemutex);
-                printf( "[Game] Starting with %d players!\n",   gamedata->playercount);  fflush( stdout);
-                addtolog( "SCHEDULER: Game Started!");
-            }  else  {
-                sleep( 2);
-                continue;
-            }
+void  rebuildhistoryindex( int  rows)  {
+    memset( historyindex,  0,   historyindexsize( historyslots));
+    historyindex->slotcount  =  historyslots;
+    HistoryRecord  record;
+    for ( int row  =  0;   row  <  rows;  row++)  {
+        if ( pread( historyfd,  &record,   sizeof( record),  ( off_t)row  *  sizeof( record))  !=   sizeof( record))  break;
+        if ( historyindex->used  *  4  >=  historyslots  *  3  &&  growhistoryindex()   ==  0)  {
+            rebuildhistoryindex( rows);
+            return;
         }
-
-        if ( gamedata->gameover)  {
-            sleep( 1);
-            continue;
+        HistorySlot  *entry  =  findhistoryslot( historyindex,   record.name,  1);
+        if ( entry)  {
+            entry->lastrow  =  row;
+            entry->games++;
         }
+        historyindex->rows  =   row  +  1;
+    }
+}
 
-        pthread_mutex_lock( &gamedata->gamemutex);
-        int  current   =  gamedata->currentturn;
-        int  attempts  =  0;
-        int  activefound   =  0;
-        
-        while ( attempts  <  MAX_PLAYERS)  {
-            if ( gamedata->players[current].active)  {
-                activefound  =   1;
-                break;
-            }
-            current  =  ( current  +  1)   %  gamedata->playercount;
-            attempts++;
-        }
-        
-        gamedata->currentturn  =  current;
-        pthread_mutex_unlock( &gamedata->gamemutex);
+void  closehistory()  {
+    if ( historyindex)  munmap( historyindex,   historyindexsize( historyslots));
+    if ( historyindexfd  !=  -1)  close( historyindexfd);
+    if ( historyfd  !=  -1)  close( historyfd);
+    historyindex  =  NULL;
+    historyindexfd  =  -1;
+    historyfd  =   -1;
+}
 
-        if ( !activefound)  {
-            resetgame();
-            continue;
-        }
+void  openhistory()  {
+    historyfd  =  open( HISTORY_FILE,   O_RDWR  |  O_CREAT  |  O_APPEND  |  O_CLOEXEC,  0666);
+    historyindexfd  =  open( HISTORY_INDEX_FILE,   O_RDWR  |  O_CREAT  |  O_CLOEXEC,  0666);
+    if ( historyfd  ==  -1  ||  historyindexfd   ==  -1)  {
+        logerror( "openhistory",   "Failed to open match history files - history disabled");
+        closehistory();
+        return;
+    }
 
-        sem_post( &gamedata->turnsem[current]);
+    flock( historyfd,  LOCK_EX);
+    flock( historyindexfd,  LOCK_EX);
+    HistoryIndex  header;
+    struct stat  info;
+    int  slots  =  HISTORY_INDEX_SLOTS;
+    if ( pread( historyindexfd,  &header,   sizeof( header),  0)  ==  sizeof( header)  &&   header.slotcount  >  0  &&
+         fstat( historyindexfd,  &info)  ==  0  &&   ( size_t)info.st_size  ==  historyindexsize( header.slotcount))  {
+        slots  =  header.slotcount;
+    }  else if ( ftruncate( historyindexfd,  0)  ==  -1  ||   ftruncate( historyindexfd,  historyindexsize( slots))  ==  -1)  {
+        slots  =  0;
+    }
+    if ( slots  ==  0  ||  maphistoryindex( slots)  ==  -1)  {
+        logerror( "openhistory",   "mmap failed on history index - history disabled");
+        flock( historyfd,  LOCK_UN);
+        closehistory();
+        return;
+    }
 
-        sem_wait( &gamedata->schedsem);
+    fstat( historyfd,   &info);
+    int  rows  =  info.st_size  /  sizeof( HistoryRecord);
+    if ( historyindex->slotcount  !=  slots  ||   historyindex->rows  !=  rows)  {
+        rebuildhistoryindex( rows);
+        char  logmessage[ 100];
+        snprintf( logmessage,  100,   "HISTORY: Rebuilt index over %d records.",  rows);
+        addtolog( logmessage);
+    }
+    flock( historyindexfd,  LOCK_UN);
+    flock( historyfd,  LOCK_UN);
+}
 
-        pthread_mutex_lock( &gamedata->gamemutex);
-        
-        char  playersymbol  =   gamedata->players[current].symbol;
-        if ( checkwin( playersymbol))  {
-            gamedata->winner   =  current;
-            gamedata->gameover  =  1;
-            printf( "\n*** WINNER: %s (Player %d) ***\n\n",   gamedata->players[current].name,  current);  fflush( stdout);
-            addtolog( "GAME: We have a winner!");
-            savescore( gamedata->players[current].name,   1);
-        }  else if ( isboardfull())  {
-             gamedata->winner  =  -1;
-             gamedata->gameover   =  1;
-             printf( "\n*** DRAW - Board is full! ***\n\n");   fflush( stdout);
-             addtolog( "GAME: Board full. Draw!");
-        }  else  {
-             int  nextplayer  =  ( current  +  1)   %  gamedata->playercount;
-             gamedata->currentturn  =  nextplayer;
-        }
-        pthread_mutex_unlock( &gamedata->gamemutex);
+void  recordmatch()  {
+    if ( historyfd  ==  -1)  return;
 
+    HistoryRecord  *records  =  malloc( gamedata->game.playercount  *   sizeof( HistoryRecord));
+    if ( !records)  {
+        logerror( "recordmatch",   "malloc failed - match not recorded");
+        return;
+    }
+    int  count  =  0;
+    time_t  now  =  time( NULL);
 
+    pthread_mutex_lock( &gamedata->gamemutex);
+    for ( int i  =  0;   i  <  gamedata->game.playercount;  i++)  {
+        if ( gamedata->players[i].name[0]  ==  '\0'  ||  gamedata->players[i].joinedgame   !=  gamedata->gamenumber)  continue;
+        HistoryRecord  *record  =  &records[count++];
+        memset( record,  0,   sizeof( HistoryRecord));
+        strncpy( record->name,   gamedata->players[i].name,  31);
+        record->finished  =  now;
+        record->moves  =   gamedata->game.movecount;
+        record->duration  =  now  -   gamedata->starttime;
+        if ( gamedata->game.winner  ==  -1)  record->result  =   'D';
+        else  record->result  =  gamedata->game.winner  ==  i  ?  'W'  :   'L';
+    }
+    pthread_mutex_unlock( &gamedata->gamemutex);
+    if ( count  ==  0)  {
+        free( records);
+        return;
+    }
 
-        if ( gamedata->gameover)  {
-            usleep( 200000);
+    TRACE_BEGIN( historystart);
+    flock( historyfd,  LOCK_EX);
+    flock( historyindexfd,  LOCK_EX);
+    struct stat  info;
+    fstat( historyfd,   &info);
+    int  firstrow  =  info.st_size  /  sizeof( HistoryRecord);
+    int  indexed  =  synchistoryindex()  !=  -1;
+    if ( !indexed)  {
+        logerror( "recordmatch",   "Cannot remap history index - match not indexed");
+    }  else  {
+        if ( historyindex->rows  !=   firstrow)  rebuildhistoryindex( firstrow);
+        if ( ( historyindex->used  +  count)  *  4  >  historyslots   *  3  &&  growhistoryindex()  ==  0)  rebuildhistoryindex( firstrow);
+    }
 
-            for ( int i  =  0;   i  <  gamedata->playercount;  i++)  {
-                sem_post( &gamedata->turnsem[i]);
-            }
-            printf( "[Scheduler] Game Over! Waiting 5s for clients to finish...\n");
-            sleep( 5);
-            resetgame();
+    for ( int i  =  0;   i  <  count;  i++)  {
+        records[i].game  =  firstrow;
+        records[i].playercount  =  count;
+        HistorySlot  *entry  =  indexed  ?  findhistoryslot( historyindex,   records[i].name,  1)  :  NULL;
+        records[i].previous  =  entry  ?  entry->lastrow  :   -1;
+        if ( entry)  {
+            entry->lastrow  =  firstrow  +   i;
+            entry->games++;
+        }  else if ( indexed)  {
+            logerror( "recordmatch",   "History index full - player chain starts over");
         }
     }
-    return  NULL;
+
+    if ( write( historyfd,  records,   count  *  sizeof( HistoryRecord))  ==   ( ssize_t)( count  *  sizeof( HistoryRecord)))  {
+        historyindex->rows  =  indexed  ?  firstrow  +   count  :  -1;
+    }  else  {
+        logerror( "recordmatch",   "Failed to append to match history");
+        historyindex->rows  =  -1;
+    }
+    flock( historyindexfd,  LOCK_UN);
+    flock( historyfd,  LOCK_UN);
+    TRACE_END( TRACE_HISTORY,  historystart,   count);
+    free( records);
 }
 
+FILE  *lockratings()  {
+    int  fd  =  open( RATING_FILE,   O_RDWR  |  O_CREAT  |  O_CLOEXEC,  0666);
+    if ( fd  ==  -1)  return  NULL;
+    flock( fd,  LOCK_EX);
+    FILE  *file  =  fdopen( fd,   "r+");
+    if ( !file)  close( fd);
+    return  file;
+}
 
-void  setupsharedmemory()  {
-    shm_unlink( SHM_NAME);
-    serverfd  =  shm_open( SHM_NAME,   O_CREAT  |  O_RDWR,  0666);
-    if ( serverfd   ==  -1)  {
-        logerror( "setupsharedmemory",   "shm_open failed - cannot create shared memory");
-        exitwitherror( "shm_open");
+void  unlockratings( FILE  *file)  {
+    fflush( file);
+    flock( fileno( file),   LOCK_UN);
+    fclose( file);
+}
+
+void  rateperiods( int  ratinghistoryfd)  {
+    FILE  *file  =  lockratings();
+    if ( !file)  {
+        logerror( "rateperiods",   "Failed to open or create " RATING_FILE);
+        return;
+    }
+    flock( ratinghistoryfd,  LOCK_SH);
+    struct stat  info;
+    fstat( ratinghistoryfd,   &info);
+    long  rows  =  info.st_size  /  sizeof( HistoryRecord);
+    long  nextrow  =  ratingnextrow( file);
+    if ( rows  <=  nextrow)  {
+        flock( ratinghistoryfd,  LOCK_UN);
+        unlockratings( file);
+        return;
     }
 
-    if ( ftruncate( serverfd,   sizeof( GameData))  ==  -1)  {
-        logerror( "setupsharedmemory",  "ftruncate failed - cannot resize shared memory");
-        exitwitherror( "ftruncate");
+    RatingConfig  config;
+    RatingTable  table;
+    ratingdefaults( &config);
+    ratinginit( &table);
+    ratingload( &table,  file);
+    long  pending  =  rows  -  table.nextrow;
+    HistoryRecord  *records  =  pending  >  0  ?  malloc( pending  *   sizeof( HistoryRecord))  :  NULL;
+    if ( records  &&  pread( ratinghistoryfd,  records,   pending  *  sizeof( HistoryRecord),  ( off_t)table.nextrow   *  sizeof( HistoryRecord))  !=  ( ssize_t)( pending   *  sizeof( HistoryRecord)))  {
+        free( records);
+        records  =   NULL;
+    }
+    flock( ratinghistoryfd,  LOCK_UN);
+
+    if ( records)  {
+        long  throughperiod  =  ( time( NULL)  -  RATING_SETTLE)   /  config.period;
+        long  first  =  table.nextrow;
+        long  periods  =  ratinghistory( &table,  records,   first,  rows,  throughperiod,   &config);
+        if ( periods  >  0)  {
+            ratingsave( &table,  file);
+            char  logmessage[ 100];
+            snprintf( logmessage,  100,   "RATING: Rated %ld records over %ld periods, %d players.",  table.nextrow  -   first,  periods,  table.count);
+            addtolog( logmessage);
+        }
+        free( records);
     }
+    ratingfree( &table);
+    unlockratings( file);
+}
 
-    gamedata  =  mmap( NULL,   sizeof( GameData),  PROT_READ  |  PROT_WRITE,  MAP_SHARED,  serverfd,   0);
-    if ( gamedata  ==  MAP_FAILED)  {
-        logerror( "setupsharedmemory",   "mmap failed - cannot map shared memory");
-        exitwitherror( "mmap");
+void  *ratingthread( void  *arg)  {
+    int  ratinghistoryfd  =  open( HISTORY_FILE,   O_RDONLY  |  O_CLOEXEC);
+    if ( ratinghistoryfd  ==  -1)  {
+        logerror( "ratingthread",   "Cannot open match history - ratings disabled");
+        return  NULL;
+    }
+    while ( !gamedata->stopflag)  {
+        rateperiods( ratinghistoryfd);
+        sleep( RATING_POLL);
     }
+    close( ratinghistoryfd);
+    return  NULL;
+}
 
-    pthread_mutexattr_t  mutexattr;
-    pthread_mutexattr_init( &mutexattr);
-    pthread_mutexattr_setpshared( &mutexattr,   PTHREAD_PROCESS_SHARED);
+void  notifyspectators()  {
+    pthread_mutex_lock( &gamedata->gamemutex);
+    gamedata->updateseq++;
+    pthread_mutex_unlock( &gamedata->gamemutex);
 
-    pthread_mutex_init( &gamedata->gamemutex,   &mutexattr);
-    pthread_mutex_init( &gamedata->logmutex,  &mutexattr);
-    
-    if ( sem_init( &gamedata->schedsem,  1,   0)  ==  -1)  {
-        logerror( "setupsharedmemory",   "sem_init for scheduler semaphore failed");
-        exitwitherror( "sem_init sched");
+    uint64_t  one  =  1;
+    if ( updatefd  !=  -1  &&  write( updatefd,   &one,  sizeof( one))  <  0)  {
+        logerror( "notifyspectators",   "eventfd write failed");
     }
-    
-    for( int i=0;   i<MAX_PLAYERS;  i++)  {
-        if ( sem_init( &gamedata->turnsem[i],   1,  0)  ==  -1)  {
-            char  errormessage[ 64];
-            snprintf( errormessage,  64,   "sem_init for turnsem[%d] failed",  i);
-            logerror( "setupsharedmemory",  errormessage);
-            exitwitherror( "sem_init turn");
-        }
+}
+
+void  publishload()  {
+    if ( !shardtable)  return;
+    pthread_mutex_lock( &gamedata->gamemutex);
+    int  openseats  =  0;
+    if ( !gamedata->started  &&  gamedata->connected  <  maxplayers)  {
+        openseats  =  maxplayers   -  gamedata->connected;
     }
+    pthread_mutex_unlock( &gamedata->gamemutex);
+    __atomic_store_n( &shardtable[shardid].openseats,   openseats,  __ATOMIC_RELAXED);
+}
 
-    pthread_mutexattr_destroy( &mutexattr);
-    
-    gamedata->playercount  =  0;
-    gamedata->connected   =  0;
-    gamedata->started  =  0;
-    gamedata->gameover  =  0;
-    gamedata->stopflag   =  0;
-    memset( gamedata->board,  ' ',   sizeof( gamedata->board));
-    
-    gamedata->logqueue.head  =  0;
-    gamedata->logqueue.tail   =  0;
+int  federationsend( const char  *data,   int  length)  {
+    pthread_mutex_lock( &federationlock);
+    int  sent  =  federationfd  !=  -1  &&  send( federationfd,   data,  length,   MSG_NOSIGNAL  |  MSG_DONTWAIT)  ==  length;
+    pthread_mutex_unlock( &federationlock);
+    return  sent  ?  0   :  -1;
+}
 
-    printf( "[Server Core] Shared Memory initialized.\n");
+void  queuewin( const char  *playername,   int  wins)  {
+    pthread_mutex_lock( &federationlock);
+    int  i  =  0;
+    while ( i  <  pendingcount  &&  strcmp( pendingwins[i].name,   playername)  !=  0)  i++;
+    if ( i  ==  pendingcount  &&  pendingcount  <  FEDERATION_MAX_PENDING)  {
+        memset( &pendingwins[i],  0,   sizeof( ScoreRecord));
+        strncpy( pendingwins[i].name,   playername,  31);
+        pendingcount++;
+    }
+    int  queued  =  i  <  pendingcount;
+    if ( queued)  pendingwins[i].wins  +=   wins;
+    pthread_mutex_unlock( &federationlock);
+    if ( !queued)  logerror( "federatewin",   "Win queue full - win kept in local scores only");
 }
 
-void  handleclient( int  socketfd,   int  playerid)  {
-    char  buffer[ BUFFER_SIZE];
-    
-    sleep( 1);
-    const char  *welcome  =  "WELCOME\n";
-    send( socketfd,   welcome,  strlen( welcome),  0);
+void  federatewin( const char  *playername)  {
+    if ( coordinatorport  ==  -1)   return;
+    char  line[ 64];
+    int  length  =  snprintf( line,  sizeof( line),   "%s %s 1\n",  MSG_WON,   playername);
+    if ( federationsend( line,  length)   ==  -1)  queuewin( playername,   1);
+}
 
-    memset( buffer,  0,   BUFFER_SIZE);
-    read( socketfd,  buffer,  BUFFER_SIZE);
-    
+int  replaywins()  {
+    pthread_mutex_lock( &federationlock);
+    while ( pendingcount  >  0  &&  federationfd  !=  -1)  {
+        ScoreRecord  *pending  =  &pendingwins[ pendingcount  -  1];
+        char  line[ 64];
+        int  length  =  snprintf( line,  sizeof( line),   "%s %s %d\n",  MSG_WON,   pending->name,  pending->wins);
+        if ( send( federationfd,  line,   length,  MSG_NOSIGNAL  |  MSG_DONTWAIT)  !=   length)  break;
+        pendingcount--;
+    }
+    int  left  =  pendingcount;
+    pthread_mutex_unlock( &federationlock);
+    return  left  >  0  ?  -1   :  0;
+}
+
+int  connectcoordinator()  {
+    struct sockaddr_in  address;
+    memset( &address,   0,  sizeof( address));
+    address.sin_family  =  AF_INET;
+    address.sin_port   =  htons( coordinatorport);
+    if ( inet_pton( AF_INET,  coordinatorhost,   &address.sin_addr)  <=  0)  return  -1;
+
+    int  fd  =  socket( AF_INET,   SOCK_STREAM  |  SOCK_CLOEXEC,  0);
+    if ( fd  <  0)   return  -1;
+    if ( connect( fd,  ( struct sockaddr  *)&address,   sizeof( address))  <  0)  {
+        close( fd);
+        return  -1;
+    }
+
+    struct sockaddr_in  local;
+    socklen_t  locallength  =  sizeof( local);
+    char  localhost[ INET_ADDRSTRLEN]  =  "127.0.0.1";
+    if ( getsockname( fd,  ( struct sockaddr  *)&local,   &locallength)  ==  0)  {
+        inet_ntop( AF_INET,  &local.sin_addr,   localhost,  sizeof( localhost));
+    }
+
+    ScoreRecord  snapshot[ 100];
     pthread_mutex_lock( &gamedata->gamemutex);
-    strncpy( gamedata->players[playerid].name,   buffer,  31);
-    gamedata->players[playerid].active  =  1;
+    int  count  =  gamedata->scorecount;
+    memcpy( snapshot,  gamedata->scores,   count  *  sizeof( ScoreRecord));
+    pthread_mutex_unlock( &gamedata->gamemutex);
+    pthread_mutex_lock( &federationlock);
+    for ( int i  =  0;   i  <  count;  i++)  {
+        for ( int j  =  0;   j  <  pendingcount;  j++)  {
+            if ( strcmp( snapshot[i].name,  pendingwins[j].name)   ==  0)  snapshot[i].wins  -=  pendingwins[j].wins;
+        }
+    }
+    pthread_mutex_unlock( &federationlock);
+
+    char  line[ 128];
+    int  length  =  snprintf( line,  sizeof( line),   "%s %s %d %d\n",  MSG_REGISTER,   localhost,  port,   maxplayers);
+    int  failed  =  send( fd,  line,   length,  MSG_NOSIGNAL)  !=  length;
+    for ( int i  =  0;   i  <  count  &&  !failed;  i++)  {
+        length  =  snprintf( line,  sizeof( line),   "%s %s %d\n",  MSG_SCORE,   snapshot[i].name,  snapshot[i].wins);
+        failed  =  send( fd,   line,  length,  MSG_NOSIGNAL)   !=  length;
+    }
+    if ( failed)  {
+        close( fd);
+        return   -1;
+    }
+    return  fd;
+}
+
+void  dropcoordinator()  {
+    pthread_mutex_lock( &federationlock);
+    close( federationfd);
+    federationfd  =   -1;
+    pthread_mutex_unlock( &federationlock);
+    logerror( "federationthread",   "Lost coordinator connection - reconnecting");
+}
+
+void  readcoordinator( char  *input,   int  *length)  {
+    ssize_t  received  =  recv( federationfd,  input  +  *length,   BUFFER_SIZE  -  *length  -  1,  MSG_DONTWAIT);
+    if ( received  <=  0)  {
+        if ( received  <  0  &&  ( errno  ==  EAGAIN  ||   errno  ==  EINTR))  return;
+        dropcoordinator();
+        return;
+    }
+    *length  +=  received;
+    input[ *length]   =  '\0';
+
+    char  *start  =  input;
+    char  *newline;
+    while ( ( newline  =  strchr( start,   '\n')))  {
+        *newline  =  '\0';
+        char  name[ 32];
+        int  wins;
+        if ( sscanf( start,  MSG_SCORE  " %31s %d",   name,  &wins)  ==  2)  mergescore( name,   wins);
+        start  =   newline  +  1;
+    }
+    *length  -=  start   -  input;
+    memmove( input,  start,   *length);
+    if ( *length  >=  BUFFER_SIZE  -  1)   *length  =  0;
+}
+
+void  *federationthread( void  *arg)  {
+    char  input[ BUFFER_SIZE];
+    int  length  =   0;
+    int  lastopen  =  -1,   lastconnected  =  -1;
+    time_t  lastsent  =  0;
+
+    while ( !gamedata->stopflag)  {
+        if ( federationfd  ==  -1)  {
+            int  fd  =  connectcoordinator();
+            if ( fd  ==  -1)  {
+                sleep( FEDERATION_HEARTBEAT);
+                continue;
+            }
+            pthread_mutex_lock( &federationlock);
+            federationfd  =   fd;
+            pthread_mutex_unlock( &federationlock);
+            length  =  0;
+            lastopen  =   -1;
+            addtolog( "FEDERATION: Registered with coordinator");
+        }
+        if ( replaywins()  ==  -1)  {
+            dropcoordinator();
+            continue;
+        }
+
+        pthread_mutex_lock( &gamedata->gamemutex);
+        int  connected  =  gamedata->connected;
+        int  openseats  =   !gamedata->started  &&  connected  <  maxplayers  ?  maxplayers  -   connected  :  0;
+        pthread_mutex_unlock( &gamedata->gamemutex);
+
+        time_t  now  =  time( NULL);
+        if ( openseats  !=  lastopen  ||  connected   !=  lastconnected  ||  now  -  lastsent  >=   FEDERATION_HEARTBEAT)  {
+            char  line[ 64];
+            int  linelength  =  snprintf( line,  sizeof( line),   "%s %d %d\n",  MSG_LOAD,   openseats,  connected);
+            if ( federationsend( line,  linelength)   ==  -1)  {
+                dropcoordinator();
+                continue;
+            }
+            lastopen  =  openseats;
+            lastconnected   =  connected;
+            lastsent  =  now;
+        }
+
+        struct pollfd  pollfd  =  { federationfd,   POLLIN,  0};
+        if ( poll( &pollfd,  1,   FEDERATION_POLL_MS)  >  0)  readcoordinator( input,   &length);
+    }
+    return  NULL;
+}
+
+void  resetgame()  {
+    pthread_mutex_lock( &gamedata->gamemutex);
+    enginereset( &gamedata->game);
+    gamedata->started  =  0;
+    gamedata->gamenumber++;
+    pthread_mutex_unlock( &gamedata->gamemutex);
+    publishload();
+    notifyspectators();
+    addtolog( "GAME: Board reset.");
+}
+
+void  wakeseats( int  word,   uint32_t  mask)  {
+    __atomic_add_fetch( &gamedata->turnwords[word],   1,  __ATOMIC_RELEASE);
+    syscall( SYS_futex,  &gamedata->turnwords[word],   FUTEX_WAKE_BITSET,  INT_MAX,   NULL,  NULL,  mask);
+}
+
+void  grantturn( int  playerid)  {
+    __atomic_store_n( &gamedata->turnplayer,   playerid,  __ATOMIC_RELAXED);
+    if ( playerid  >=  0)  {
+        wakeseats( playerid  /  SEATS_PER_WORD,   1u  <<  ( playerid  %  SEATS_PER_WORD));
+        return;
+    }
+    for ( int word  =  0;   word  *  SEATS_PER_WORD  <  maxplayers;  word++)  {
+        wakeseats( word,   FUTEX_BITSET_MATCH_ANY);
+    }
+}
+
+int  waitturn( int  playerid,   uint32_t  *lastseq)  {
+    uint32_t  *word  =  &gamedata->turnwords[ playerid  /  SEATS_PER_WORD];
+    uint32_t  sequence  =  __atomic_load_n( word,   __ATOMIC_ACQUIRE);
+    if ( sequence  ==  *lastseq)  {
+        struct timespec  timeout;
+        clock_gettime( CLOCK_MONOTONIC,   &timeout);
+        timeout.tv_sec  +=  1;
+        syscall( SYS_futex,  word,   FUTEX_WAIT_BITSET,  sequence,   &timeout,  NULL,  1u  <<  ( playerid  %   SEATS_PER_WORD));
+        sequence  =  __atomic_load_n( word,   __ATOMIC_ACQUIRE);
+        if ( sequence  ==  *lastseq)  return  -1;
+    }
+    *lastseq  =  sequence;
+    return  __atomic_load_n( &gamedata->turnplayer,   __ATOMIC_RELAXED)  ==  playerid  ?  0  :   -1;
+}
+
+void  waitrematch()  {
+    struct timespec  deadline;
+    clock_gettime( CLOCK_REALTIME,   &deadline);
+    deadline.tv_sec  +=  REMATCH_DEADLINE  +  1;
+
+    while ( 1)  {
+        int  waiting  =  0;
+        pthread_mutex_lock( &gamedata->gamemutex);
+        for ( int i  =  0;   i  <  gamedata->game.playercount;  i++)  {
+            if ( gamedata->game.active[i]  &&  gamedata->players[i].answeredgame   !=  gamedata->gamenumber)  waiting++;
+        }
+        pthread_mutex_unlock( &gamedata->gamemutex);
+        if ( waiting  ==  0)  break;
+        if ( sem_timedwait( &gamedata->schedsem,   &deadline)  ==  -1  &&  errno  ==   ETIMEDOUT)  break;
+    }
+
+    int  stayed  =  0,   unanswered  =  0;
+    pthread_mutex_lock( &gamedata->gamemutex);
+    for ( int i  =  0;   i  <  gamedata->game.playercount;  i++)  {
+        if ( !gamedata->game.active[i])  continue;
+        if ( gamedata->players[i].answeredgame  ==  gamedata->gamenumber)  {
+            stayed++;
+            continue;
+        }
+        enginedrop( &gamedata->game,   i);
+        if ( gamedata->connected  >  0)   gamedata->connected--;
+        unanswered++;
+    }
     pthread_mutex_unlock( &gamedata->gamemutex);
+
+    char  logmessage[ 96];
+    snprintf( logmessage,  96,  "SESSION: %d players stayed for a rematch, %d did not answer.",   stayed,  unanswered);
+    printf( "[Scheduler] %s\n",   logmessage);  fflush( stdout);
+    addtolog( logmessage);
+}
+
+void  *schedulerthread( void  *arg)  {
+    printf( "[Scheduler Thread] Started.\n");
+    TRACE_THREAD( "scheduler",  shardcount  >  1  ?  shardid   :  -1);
+    int  rematch  =  0;
+
+    while( !gamedata->stopflag)  {
+        
+        pthread_mutex_lock( &gamedata->gamemutex);
+        int  connectedcount  =   gamedata->connected;
+        int  gamestarted  =  gamedata->started;
+        pthread_mutex_unlock( &gamedata->gamemutex);
+
+        if ( !gamestarted)  {
+            if ( connectedcount  >=   MIN_PLAYERS)  {
+                if ( rematch  &&  connectedcount  <  maxplayers)  {
+                    addtolog( "SCHEDULER: Rematch seated. Holding open seats briefly...");
+                    sleep( REMATCH_LOBBY_WAIT);
+                }  else if ( connectedcount   <  maxplayers)  {
+                    printf( "[Scheduler] Minimum players met. Waiting 15s for others to join...\n");
+                    addtolog( "SCHEDULER: Minimum players met. Waiting 15s for others...");
+                    TRACE_BEGIN( lobbystart);
+                    sleep( 15);
+                    TRACE_END( TRACE_LOBBY_WAIT,  lobbystart,   connectedcount);
+                }  else  {
+                    addtolog( "SCHEDULER: Max players reached. Starting immediately!");
+                } 
+                
+                pthread_mutex_lock( &gamedata->gamemutex);
+                gamedata->started   =  1;
+                gamedata->starttime   =  time( NULL);
+                enginestart( &gamedata->game,   gamedata->game.playercount);
+                for ( int i  =  0;   i  <  gamedata->game.playercount;  i++)  {
+                    if ( gamedata->game.active[i])  gamedata->players[i].joinedgame   =  gamedata->gamenumber;
+                }
+                while ( sem_trywait( &gamedata->schedsem)  ==   0);
+                pthread_mutex_unlock( &gamedata->gamemutex);
+                rematch  =  0;
+                grantturn( -1);
+                publishload();
+                printf( "[Game] Starting with %d players!\n",   gamedata->game.playercount);  fflush( stdout);
+                notifyspectators();
+                addtolog( "SCHEDULER: Game Started!");
+            }  else  {
+                sleep( 2);
+                continue;
+            }
+        }
+
+        if ( gamedata->game.gameover)  {
+            sleep( 1);
+            continue;
+        }
+
+        pthread_mutex_lock( &gamedata->gamemutex);
+        int  current   =  enginenextplayer( &gamedata->game);
+        pthread_mutex_unlock( &gamedata->gamemutex);
+
+        if ( current  ==  -1)  {
+            resetgame();
+            continue;
+        }
+
+        TRACE_BEGIN( turnstart);
+        grantturn( current);
+
+        sem_wait( &gamedata->schedsem);
+        TRACE_END( TRACE_TURN,  turnstart,   current);
+
+        pthread_mutex_lock( &gamedata->gamemutex);
+        
+        if ( gamedata->game.gameover  &&  gamedata->game.winner   >=  0)  {
+            int  winner  =  gamedata->game.winner;
+            printf( "\n*** WINNER: %s (Player %d) ***\n\n",   gamedata->players[winner].name,  winner);  fflush( stdout);
+            addtolog( "GAME: We have a winner!");
+            savescore( gamedata->players[winner].name,   1);
+            federatewin( gamedata->players[winner].name);
+        }  else if ( gamedata->game.gameover  &&  gamedata->game.livewindows   ==  0  &&  !engineboardfull( &gamedata->game))  {
+             printf( "\n*** DRAW - No line can be completed! ***\n\n");   fflush( stdout);
+             addtolog( "GAME: Dead board. Draw!");
+        }  else if ( gamedata->game.gameover)  {
+             printf( "\n*** DRAW - Board is full! ***\n\n");   fflush( stdout);
+             addtolog( "GAME: Board full. Draw!");
+        }  else  {
+             engineadvance( &gamedata->game);
+        }
+        pthread_mutex_unlock( &gamedata->gamemutex);
+        notifyspectators();
+
+
+
+        if ( gamedata->game.gameover)  {
+            recordmatch();
+            notifyspectators();
+
+            char  statsmessage[ 160];
+            snprintf( statsmessage,  160,   "STATS: queued bytes %ld, forced disconnects %d, coalesced spectator updates %d, dropped spectator updates %d",
+                      __atomic_load_n( &gamedata->queuedbytes,   __ATOMIC_RELAXED),  gamedata->forceddisconnects,
+                      gamedata->coalescedupdates,   gamedata->droppedupdates);
+            addtolog( statsmessage);
+            TRACE_BEGIN( overstart);
+            usleep( 200000);
+
+            grantturn( -1);
+            printf( "[Scheduler] Game Over! Waiting up to %ds for rematch answers...\n",   REMATCH_DEADLINE);
+            waitrematch();
+            TRACE_END( TRACE_GAME_OVER_WAIT,  overstart,   gamedata->game.winner);
+            resetgame();
+            rematch  =  1;
+        }
+    }
+    return  NULL;
+}
+
+
+void  setupsharedmemory()  {
+    shm_unlink( shmname);
+    serverfd  =  shm_open( shmname,   O_CREAT  |  O_RDWR  |  O_CLOEXEC,  0666);
+    if ( serverfd   ==  -1)  {
+        logerror( "setupsharedmemory",   "shm_open failed - cannot create shared memory");
+        exitwitherror( "shm_open");
+    }
+
+    size_t  headersize  =  ( sizeof( GameData)  +  7)   &  ~( size_t)7;
+    size_t  playersize  =  ( maxplayers  *  sizeof( Player)   +  7)  &  ~( size_t)7;
+    size_t  wordsize  =  ( ( maxplayers  +  SEATS_PER_WORD  -  1)   /  SEATS_PER_WORD  *  sizeof( uint32_t)  +  7)   &  ~( size_t)7;
+    gamedatasize  =  headersize  +  playersize   +  wordsize  +  enginesize( maxplayers,  boardsize);
+    if ( ftruncate( serverfd,   gamedatasize)  ==  -1)  {
+        logerror( "setupsharedmemory",  "ftruncate failed - cannot resize shared memory");
+        exitwitherror( "ftruncate");
+    }
+
+    gamedata  =  mmap( NULL,   gamedatasize,  PROT_READ  |  PROT_WRITE,  MAP_SHARED,  serverfd,   0);
+    if ( gamedata  ==  MAP_FAILED)  {
+        logerror( "setupsharedmemory",   "mmap failed - cannot map shared memory");
+        exitwitherror( "mmap");
+    }
+
+    pthread_mutexattr_t  mutexattr;
+    pthread_mutexattr_init( &mutexattr);
+    pthread_mutexattr_setpshared( &mutexattr,   PTHREAD_PROCESS_SHARED);
+
+    pthread_mutex_init( &gamedata->gamemutex,   &mutexattr);
+    pthread_mutex_init( &gamedata->logmutex,  &mutexattr);
     
-    printf( "[Server] Player %d joined: %s\n",   playerid,  buffer);  fflush( stdout);
-    addtolog( "Player joined");
+    if ( sem_init( &gamedata->schedsem,  1,   0)  ==  -1)  {
+        logerror( "setupsharedmemory",   "sem_init for scheduler semaphore failed");
+        exitwitherror( "sem_init sched");
+    }
+
+    gamedata->players  =  ( Player  *)( ( char  *)gamedata   +  headersize);
+    gamedata->turnwords  =  ( uint32_t  *)( ( char  *)gamedata   +  headersize  +  playersize);
+    engineinit( &gamedata->game,   ( char  *)gamedata  +  headersize  +   playersize  +  wordsize,  maxplayers,  boardsize,   WIN_LEN);
+    gamedata->turnplayer   =  -1;
+
+    pthread_mutexattr_destroy( &mutexattr);
+    
+    gamedata->game.playercount  =  0;
+    gamedata->connected   =  0;
+    gamedata->started  =  0;
+    gamedata->game.gameover  =  0;
+    gamedata->stopflag   =  0;
+    gamedata->gamenumber  =   1;
+    
+    gamedata->logqueue.head  =  0;
+    gamedata->logqueue.tail   =  0;
+
+    printf( "[Server Core] Shared Memory initialized.\n");
+}
+
+int  turnmessagesize()  {
+    return  strlen( MSG_YOUR_TURN)  +   2  +  enginerendersize( &gamedata->game);
+}
+
+int  buildturnmessage( char  *message)  {
+    int  position  =  sprintf( message,   "%s\n",  MSG_YOUR_TURN);
+    pthread_mutex_lock( &gamedata->gamemutex);
+    position  +=  enginerender( &gamedata->game,   message  +  position);
+    pthread_mutex_unlock( &gamedata->gamemutex);
+    message[position]  =  '\0';
+    return  position;
+}
+
+int  flushoutput( OutputQueue  *queue)  {
+    while ( queue->length  >  0)  {
+        ssize_t  sent  =  transportsend( queue->connection,   queue->data,  queue->length,   1);
+        if ( sent  <  0)  {
+            if ( errno  ==  EAGAIN  ||  errno   ==  EWOULDBLOCK)  break;
+            return  -1;
+        }
+        queue->length  -=  sent;
+        memmove( queue->data,   queue->data  +  sent,  queue->length);
+        __atomic_sub_fetch( &gamedata->queuedbytes,   sent,  __ATOMIC_RELAXED);
+    }
+
+    if ( queue->congested  &&  queue->length   <=  OUTPUT_LOW_WATER)  {
+        queue->congested  =  0;
+    }
+    if ( queue->congested  &&  time( NULL)  -  queue->congestedsince   >=  SLOW_PLAYER_DEADLINE)  {
+        return  -1;
+    }
+    return  0;
+}
+
+int  queueoutput( OutputQueue  *queue,   const char  *data,  int  length)  {
+    if ( queue->length  +  length  >  OUTPUT_QUEUE_SIZE)  return  -1;
+
+    memcpy( queue->data  +  queue->length,   data,  length);
+    queue->length  +=  length;
+    __atomic_add_fetch( &gamedata->queuedbytes,   length,  __ATOMIC_RELAXED);
+
+    if ( !queue->congested  &&  queue->length   >  OUTPUT_HIGH_WATER)  {
+        queue->congested  =  1;
+        queue->congestedsince  =   time( NULL);
+    }
+    return  flushoutput( queue);
+}
+
+int  drainoutput( OutputQueue  *queue)  {
+    time_t  deadline  =  time( NULL)  +   SLOW_PLAYER_DEADLINE;
+    while ( queue->length  >  0)  {
+        int  remaining  =  deadline  -  time( NULL);
+        if ( remaining  <=  0)  return  -1;
+
+        if ( transportwait( queue->connection,  1,   remaining  *  1000)  <  0)  return  -1;
+        if ( flushoutput( queue)  ==  -1)   return  -1;
+    }
+    return  0;
+}
+
+void  dropplayer( int  playerid,   const char  *reason)  {
+    char  errormessage[ 128];
+    snprintf( errormessage,  128,  "%s - Player %d (socketfd=%d, %s)",   reason,  playerid,  connection.fd,   transportname( connection.kind));
+    logerror( "handleclient",  errormessage);
+
+    pthread_mutex_lock( &gamedata->gamemutex);
+    if ( gamedata->game.active[playerid])  {
+        enginedrop( &gamedata->game,   playerid);
+        if ( gamedata->connected   >  0)  gamedata->connected--;
+    }
+    pthread_mutex_unlock( &gamedata->gamemutex);
+}
+
+int  sendplayer( int  playerid,   const char  *data,  int  length)  {
+    if ( queueoutput( &output,  data,   length)  ==  0)  return  0;
+
+    __atomic_add_fetch( &gamedata->forceddisconnects,   1,  __ATOMIC_RELAXED);
+    dropplayer( playerid,   "Slow client disconnected - output queue over limit");
+    addtolog( "DISCONNECT: Slow client force-disconnected.");
+    return  -1;
+}
+
+int  sendresult( int  playerid,   int  winnerid)  {
+    const char  *result  =  winnerid  ==  playerid  ?  MSG_WIN   :  winnerid  ==  -1  ?  MSG_DRAW   :  MSG_LOSE;
+    char  message[ 32];
+    int  length  =  snprintf( message,  sizeof( message),   "%s %s\n",  MSG_GAME_OVER,   result);
+    return  sendplayer( playerid,   message,  length);
+}
+
+void  parsepremove( const char  *line)  {
+    const char  *cursor  =  line  +  strlen( MSG_PREMOVE);
+    while ( *cursor  ==  ' ')  cursor++;
+    if ( strncmp( cursor,  MSG_PREMOVE_CLEAR,   strlen( MSG_PREMOVE_CLEAR))  ==  0)  {
+        premovecount  =  0;
+        return;
+    }
+    if ( premovecount  ==  PREMOVE_QUEUE)  return;
+
+    Premove  *premove  =  &premoves[ ( premovehead  +  premovecount)   %  PREMOVE_QUEUE];
+    int  row,   col,  used;
+    premove->count  =  0;
+    while ( premove->count  <  PREMOVE_CHOICES  &&   sscanf( cursor,  "%d %d%n",  &row,   &col,  &used)  ==  2)  {
+        premove->rows[ premove->count]  =  row;
+        premove->cols[ premove->count++]   =  col;
+        cursor  +=  used;
+    }
+    if ( premove->count  >  0)  premovecount++;
+}
+
+void  readpremoves( const char  *data,   int  length)  {
+    if ( premovelength  +  length  >=  BUFFER_SIZE)  premovelength  =   0;
+    if ( length  >=  BUFFER_SIZE)  return;
+    memcpy( premoveinput  +  premovelength,   data,  length);
+    premovelength  +=  length;
+
+    char  *line  =  premoveinput;
+    char  *end;
+    while ( ( end  =  memchr( line,  '\n',   premovelength  -  ( line  -  premoveinput)))  !=  NULL)  {
+        *end  =  '\0';
+        char  *premove  =  strstr( line,   MSG_PREMOVE);
+        if ( premove)  parsepremove( premove);
+        line  =  end  +  1;
+    }
+    premovelength  -=  line  -  premoveinput;
+    memmove( premoveinput,   line,  premovelength);
+}
+
+int  collectpremoves()  {
+    char  data[ BUFFER_SIZE];
+    while ( transportwait( &connection,  0,   0)  >  0)  {
+        ssize_t  count  =  transportrecv( &connection,   data,  sizeof( data));
+        if ( count  <=  0)  return  -1;
+        readpremoves( data,   count);
+    }
+    return  0;
+}
+
+int  applymove( int  playerid,   int  row,  int  col)  {
+    TRACE_BEGIN( lockstart);
+    pthread_mutex_lock( &gamedata->gamemutex);
+    TRACE_END( TRACE_MUTEX_WAIT,  lockstart,   playerid);
+    TRACE_BEGIN( validatestart);
+    int  outcome  =  engineplay( &gamedata->game,  playerid,   row,  col);
+    TRACE_END( TRACE_VALIDATE,  validatestart,   outcome);
+    if ( outcome  ==  MOVE_INVALID)  {
+        pthread_mutex_unlock( &gamedata->gamemutex);
+        return  0;
+    }
+
+    char  logmessage[ 96];
+    char  identifier[ 8];
+    engineidentifier( &gamedata->game,   playerid,  identifier);
+    snprintf( logmessage,  96,  "MOVE: Player %s placed %s at %d,%d",  gamedata->players[playerid].name,   identifier,  row,  col);
+    printf( "[Child %d] %s\n",  playerid,  logmessage);   fflush( stdout);
+    pthread_mutex_unlock( &gamedata->gamemutex); 
+    addtolog( logmessage);
+    return  1;
+}
+
+int  playpremove( int  playerid)  {
+    if ( premovecount  ==  0)  return  0;
+
+    Premove  *premove  =  &premoves[ premovehead];
+    premovehead  =  ( premovehead  +  1)  %   PREMOVE_QUEUE;
+    premovecount--;
+    for ( int i  =  0;   i  <  premove->count;  i++)  {
+        if ( !applymove( playerid,  premove->rows[i],   premove->cols[i]))  continue;
+
+        char  notice[ 48];
+        int  length  =  snprintf( notice,   sizeof( notice),  "%s %d %d\n",  MSG_PREMOVED,   premove->rows[i],  premove->cols[i]);
+        return  sendplayer( playerid,   notice,  length)  ==  -1  ?  -1   :  1;
+    }
+    return  0;
+}
+
+int  finishturn( int  playerid)  {
+    sem_post( &gamedata->schedsem);
     
-    while( 1)  {
+    pthread_mutex_lock( &gamedata->gamemutex);
+    if ( gamedata->game.gameover  &&  gamedata->game.winner   ==  playerid)  {
+         printf( "[Game] Player %d (%s) WINS!\n",  playerid,  gamedata->players[playerid].name);   fflush( stdout);
+         pthread_mutex_unlock( &gamedata->gamemutex);
+         sendresult( playerid,   playerid);
+         return  TURN_WON;
+    }
+    pthread_mutex_unlock( &gamedata->gamemutex);
+    return  TURN_PLAYED;
+}
+
+int  formatthreats( char  *output,   int  capacity,  int  minimum)  {
+    int  position  =  0;
+    char  identifier[ 8];
+    for ( int i  =  0;   i  <  gamedata->game.playercount  &&  position   <  capacity;  i++)  {
+        int  windows;
+        int  longest  =  gamedata->game.active[i]  ?  enginethreat( &gamedata->game,   i,  &windows)  :  0;
+        if ( longest  <  minimum  ||  longest  ==  0)  continue;
+        engineidentifier( &gamedata->game,   i,  identifier);
+        position  +=  snprintf( output  +  position,   capacity  -  position,  " %s:%d:%d",   identifier,  longest,   windows);
+    }
+    return  position  <  capacity  ?  position   :  capacity  -  1;
+}
+
+int  answerquery( int  playerid,   const char  *request)  {
+    char  reply[ BUFFER_SIZE];
+    int  length;
+    pthread_mutex_lock( &gamedata->gamemutex);
+    if ( strncmp( request,  MSG_HINT,   strlen( MSG_HINT))  ==  0)  {
+        int  row,   col;
+        if ( enginehint( &gamedata->game,  playerid,   &row,  &col))  length  =  snprintf( reply,   sizeof( reply),  "%s %d %d\n",  MSG_HINT,   row,  col);
+        else  length  =  snprintf( reply,   sizeof( reply),  "%s NONE\n",  MSG_HINT);
+    }  else  {
+        length  =  sprintf( reply,   "%s",  MSG_THREATS);
+        length  +=  formatthreats( reply  +  length,   sizeof( reply)  -  length  -   1,  1);
+        reply[length++]  =  '\n';
+    }
+    pthread_mutex_unlock( &gamedata->gamemutex);
+    return  sendplayer( playerid,   reply,  length);
+}
+
+int  playturn( int  playerid,  char  *buffer)  {
+    if ( collectpremoves()  ==  -1)  {
+        dropplayer( playerid,   "Client dropped while waiting for turn");
+        addtolog( "DISCONNECT: Client dropped while waiting for turn.");
+        sem_post( &gamedata->schedsem);
+        return  TURN_DISCONNECTED;
+    }
+    int  premoved  =  playpremove( playerid);
+    if ( premoved  ==  -1)  {
+        sem_post( &gamedata->schedsem);
+        return  TURN_DISCONNECTED;
+    }
+    if ( premoved)  return  finishturn( playerid);
+
+    TRACE_BEGIN( sendstart);
+    int  length  =  buildturnmessage( turnmessage);
+    int  delivered  =  sendplayer( playerid,  turnmessage,   length)  !=  -1  &&  drainoutput( &output)   !=  -1;
+    TRACE_END( TRACE_BOARD_SEND,  sendstart,   length);
+    if ( !delivered)  {
+        if ( gamedata->game.active[playerid])  {
+            __atomic_add_fetch( &gamedata->forceddisconnects,   1,  __ATOMIC_RELAXED);
+            dropplayer( playerid,   "Slow client disconnected - turn not delivered before deadline");
+        }
+        sem_post( &gamedata->schedsem);
+        return  TURN_DISCONNECTED;
+    }
+
+    int  validmove  =  0;
+    while ( !validmove)  {
+        memset( buffer,  0,   BUFFER_SIZE);
+        TRACE_BEGIN( readstart);
+        int  received  =  transportrecv( &connection,  buffer,  BUFFER_SIZE);
+        TRACE_END( TRACE_MOVE_RECEIVE,  readstart,   received);
+        if ( received   <=  0)  {
+             dropplayer( playerid,   "Client dropped during turn");
+             addtolog( "DISCONNECT: Client dropped during turn.");
+             sem_post( &gamedata->schedsem);
+             return  TURN_DISCONNECTED;
+        }
+
+        if ( strstr( buffer,   "TIMEOUT"))  {
+             printf( "[Child %d] Received Client TIMEOUT signal. Skipping move processing.\n",   playerid);
+             validmove  =  1;
+             continue;
+        }
+
+        pthread_mutex_lock( &gamedata->gamemutex);
+        int  thisturn  =   gamedata->game.currentturn;
+        pthread_mutex_unlock( &gamedata->gamemutex);
+
+        if ( thisturn  !=  playerid)  {
+             printf( "[Child %d] Move rejected - TIMEOUT (Turn moved to %d)\n",  playerid,   thisturn);
+             sendplayer( playerid,  "*** TIMEOUT! Your turn was skipped. ***\n",   40);
+             validmove  =  1;
+             continue;
+        }
+
+        if ( strncmp( buffer,  MSG_HINT,   strlen( MSG_HINT))  ==  0  ||  strncmp( buffer,   MSG_THREATS,  strlen( MSG_THREATS))  ==   0)  {
+            if ( answerquery( playerid,  buffer)   ==  -1)  {
+                sem_post( &gamedata->schedsem);
+                return  TURN_DISCONNECTED;
+            }
+            continue;
+        }
+
+        if ( strstr( buffer,  MSG_PREMOVE))  {
+            readpremoves( buffer,   received);
+            int  queued  =  premovecount;
+            premoved  =  playpremove( playerid);
+            if ( premoved  ==  0  &&  queued  >  0)  {
+                premoved  =  sendplayer( playerid,  MSG_PREMOVE_DROPPED  "\n",   strlen( MSG_PREMOVE_DROPPED  "\n"));
+            }
+            if ( premoved  ==  -1)  {
+                sem_post( &gamedata->schedsem);
+                return  TURN_DISCONNECTED;
+            }
+            validmove  =  premoved;
+            continue;
+        }
+
+        int  row,   col;
+        if ( sscanf( buffer,  "%d %d",  &row,   &col)  ==  2)  validmove  =  applymove( playerid,   row,  col);
+
+        int  sent;
+        if ( validmove)  sent  =  sendplayer( playerid,  MSG_VALID_MOVE  "\n",  strlen( MSG_VALID_MOVE  "\n"));
+        else  sent  =  sendplayer( playerid,  MSG_INVALID_MOVE  "\n",  strlen( MSG_INVALID_MOVE  "\n"));
+        if ( sent  ==  -1)  {
+             sem_post( &gamedata->schedsem);
+             return  TURN_DISCONNECTED;
+        }
+    }
+
+    return  finishturn( playerid);
+}
+
+int  playsession( int  playerid,   char  *buffer,  uint32_t  *lastseq)  {
+    int  pendingturn  =  0;
+    while( gamedata->game.active[playerid])  {
         pthread_mutex_lock( &gamedata->gamemutex);
-        int  gamestarted  =  gamedata->started;
+        Player  *player  =  &gamedata->players[playerid];
+        int  gamestarted  =  gamedata->started  &&  player->joinedgame   ==  gamedata->gamenumber  &&  player->answeredgame  !=   gamedata->gamenumber;
         pthread_mutex_unlock( &gamedata->gamemutex);
         
         if ( gamestarted)  {
-             send( socketfd,   "START",  5,  0);
-             usleep( 100000);
+             char  identifier[ 8];
+             char  startmessage[ 64];
+             engineidentifier( &gamedata->game,   playerid,  identifier);
+             int  length  =  snprintf( startmessage,  sizeof( startmessage),   "%s %d %d %s\n",  MSG_START,
+                                     gamedata->game.boardsize,   gamedata->game.cellwidth,  identifier);
+             sendplayer( playerid,   startmessage,  length);
+             premovecount  =  0;
+             premovelength   =  0;
              break;
         }
-        sleep( 1);
+        if ( flushoutput( &output)  ==  -1)  dropplayer( playerid,   "Client unreachable while waiting for start");
+        if ( waitturn( playerid,   lastseq)  ==  0)  pendingturn  =  1;
     }
 
-    while ( 1)  {
-        
-        struct timespec  timeout;
-        clock_gettime( CLOCK_REALTIME,   &timeout);
-        timeout.tv_sec  +=  1;
-
-        int  result  =  sem_timedwait( &gamedata->turnsem[playerid],   &timeout);
+    while ( gamedata->game.active[playerid])  {
+        int  result  =  pendingturn  ?  0  :  waitturn( playerid,   lastseq);
+        pendingturn   =  0;
+        if ( result  ==  0)  TRACE_MARK( TRACE_TURN_GRANT,  playerid);
         
         pthread_mutex_lock( &gamedata->gamemutex);
-        int  isover  =   gamedata->gameover;
-        int  winnerid  =  gamedata->winner;
+        int  isover  =   gamedata->game.gameover;
+        int  winnerid  =  gamedata->game.winner;
         pthread_mutex_unlock( &gamedata->gamemutex);
         
         if ( isover)  {
             if ( winnerid   ==  playerid)  {
                 printf( "[Game] Player %d (%s) WINS!\n",  playerid,   gamedata->players[playerid].name);  fflush( stdout);
-                send( socketfd,  MSG_WIN,   strlen( MSG_WIN),  0);
             }
             else if ( winnerid  ==  -1)  {
                 printf( "[Game] Player %d notified of DRAW\n",   playerid);  fflush( stdout);
-                send( socketfd,  MSG_DRAW,  strlen( MSG_DRAW),   0);
             }
             else  {
                 printf( "[Game] Player %d notified of LOSS\n",  playerid);   fflush( stdout);
-                send( socketfd,  MSG_LOSE,   strlen( MSG_LOSE),  0);
             }
-            break;
+            sendresult( playerid,   winnerid);
+            return  0;
         }
         
-        if ( result  ==  0)  {
-            pthread_mutex_lock( &gamedata->gamemutex);
-            if ( gamedata->gameover)  {
-                 int  winnerid   =  gamedata->winner;
-                 pthread_mutex_unlock( &gamedata->gamemutex);
-                 
-                 if ( winnerid  ==  playerid)  {
-                     send( socketfd,  MSG_WIN,   strlen( MSG_WIN),  0);
-                 }  else if ( winnerid   ==  -1)  {
-                     send( socketfd,  MSG_DRAW,  strlen( MSG_DRAW),   0);
-                 }  else  {
-                     send( socketfd,   MSG_LOSE,  strlen( MSG_LOSE),  0);
-                 }
-                 break;
-            }
-            pthread_mutex_unlock( &gamedata->gamemutex);
-
-            send( socketfd,  MSG_YOUR_TURN,   strlen( MSG_YOUR_TURN),  0);
-            usleep( 100000);
-            char  boardstring[ BOARD_SIZE   *  BOARD_SIZE  +  BOARD_SIZE  +  1];
-            int  position  =  0;
-            pthread_mutex_lock( &gamedata->gamemutex);
-            for( int row=0;  row<BOARD_SIZE;   row++)  {
-                for( int col=0;   col<BOARD_SIZE;  col++)  {
-                    boardstring[position++]  =  gamedata->board[row][col];
-                }
-                boardstring[position++]   =  '\n';
+        if ( result  !=  0)  {
+            if ( flushoutput( &output)  ==  -1)  {
+                __atomic_add_fetch( &gamedata->forceddisconnects,   1,  __ATOMIC_RELAXED);
+                dropplayer( playerid,   "Slow client disconnected - output stalled past deadline");
             }
-            boardstring[position]  =  '\0';
-            pthread_mutex_unlock( &gamedata->gamemutex);
-            sleep( 1); 
-            send( socketfd,  boardstring,   strlen( boardstring),  0);
-
-            int  validmove  =  0;
-            int  disconnected   =  0;
-            while ( !validmove)  {
-                memset( buffer,  0,  BUFFER_SIZE);
-                if ( read( socketfd,  buffer,   BUFFER_SIZE)  <=  0)  {
-                     char  errormessage[ 128];
-                     snprintf( errormessage,   128,  "Client dropped during turn - Player %d (socketfd=%d)",  playerid,  socketfd);
-                     logerror( "handleclient",   errormessage);
-                     addtolog( "DISCONNECT: Client dropped during turn.");
-                     
-                     pthread_mutex_lock( &gamedata->gamemutex);
-                     gamedata->players[playerid].active   =  0;
-                     if ( gamedata->connected  >  0)   gamedata->connected--;
-                     pthread_mutex_unlock( &gamedata->gamemutex);
-                     
-                     sem_post( &gamedata->schedsem);
-                     disconnected  =  1;
-                     break;
-                }
+            continue;
+        }
 
-                int  row,  col;
-                if ( sscanf( buffer,  "%d %d",   &row,  &col)  ==  2)  {
-                    pthread_mutex_lock( &gamedata->gamemutex);
-                    if ( row  >=  0  &&  row  <  BOARD_SIZE  &&  col  >=  0   &&  col  <  BOARD_SIZE  &&  gamedata->board[row][col]  ==  ' ')  {
-                        gamedata->board[row][col]  =  gamedata->players[playerid].symbol;
-                        validmove   =  1;
-                        char  logmessage[ 64];
-                        snprintf( logmessage,  64,  "MOVE: Player %s placed %c at %d,%d",   gamedata->players[playerid].name,  gamedata->players[playerid].symbol,  row,  col);
-                        printf( "[Child %d] %s\n",  playerid,   logmessage);  fflush( stdout);
-                        pthread_mutex_unlock( &gamedata->gamemutex); 
-                        addtolog( logmessage);
-                    }  else  {
-                        pthread_mutex_unlock( &gamedata->gamemutex);
-                    }
-                }
+        int  turn  =  playturn( playerid,   buffer);
+        if ( turn  ==  TURN_WON)  return  0;
+        if ( turn  ==  TURN_DISCONNECTED)  return  -1;
+    }
+    return  -1;
+}
+
+void  lookuprating( const char  *name,   double  *rating,  double  *deviation)  {
+    FILE  *ratings  =  fopen( RATING_FILE,   "re");
+    struct stat  info;
+    if ( ratings  &&  fstat( fileno( ratings),   &info)  ==  0  &&
+         ( info.st_mtim.tv_sec  !=  ratingstamp.tv_sec  ||   info.st_mtim.tv_nsec  !=  ratingstamp.tv_nsec)  &&
+         flock( fileno( ratings),  LOCK_SH  |   LOCK_NB)  ==  0)  {
+        ratinglookup( ratings,  name,   &cachedrating,  &cacheddeviation);
+        ratingstamp  =  info.st_mtim;
+    }
+    if ( ratings)  fclose( ratings);
+    *rating  =  cachedrating;
+    *deviation   =  cacheddeviation;
+}
+
+int  offerrematch( int  playerid,   char  *buffer)  {
+    pthread_mutex_lock( &gamedata->gamemutex);
+    Player  *player  =  &gamedata->players[playerid];
+    player->games++;
+    if ( gamedata->game.winner  ==  playerid)  player->wins++;
+    int  gamenumber  =  gamedata->gamenumber;
+    int  games  =  player->games,   wins  =  player->wins;
+    char  name[ 32];
+    strncpy( name,  player->name,   sizeof( name));
+    pthread_mutex_unlock( &gamedata->gamemutex);
 
-                if ( validmove)  send( socketfd,   MSG_VALID_MOVE,  strlen( MSG_VALID_MOVE),  0);
-                else  send( socketfd,  MSG_INVALID_MOVE,   strlen( MSG_INVALID_MOVE),  0);
+    double  rating,   deviation;
+    lookuprating( name,  &rating,   &deviation);
+    char  prompt[ 96];
+    int  length  =  snprintf( prompt,  sizeof( prompt),   "%s %d %d %.0f %.0f\n",  MSG_PLAY_AGAIN,   games,  wins,  rating,   deviation);
+
+    int  again  =  0;
+    if ( sendplayer( playerid,  prompt,   length)  !=  -1  &&  drainoutput( &output)   !=  -1)  {
+        time_t  deadline  =  time( NULL)  +   REMATCH_DEADLINE;
+        int  remaining;
+        while ( ( remaining  =  deadline  -  time( NULL))  >   0)  {
+            int  ready  =  transportwait( &connection,   0,  remaining  *  1000);
+            if ( ready  <  0)  break;
+            if ( ready  ==  0)   continue;
+            memset( buffer,  0,   BUFFER_SIZE);
+            if ( transportrecv( &connection,  buffer,   BUFFER_SIZE  -  1)  <=  0)  break;
+            if ( strstr( buffer,  MSG_AGAIN))  {
+                again  =  1;
+                break;
             }
+            if ( strstr( buffer,   MSG_LEAVE))  break;
+        }
+    }
 
-            if ( disconnected)   break;
+    pthread_mutex_lock( &gamedata->gamemutex);
+    int  counted  =  gamedata->game.active[playerid]  &&  gamedata->gamenumber   ==  gamenumber;
+    if ( counted  &&  again)  {
+        player->answeredgame   =  gamenumber;
+    }  else if ( counted)  {
+        enginedrop( &gamedata->game,   playerid);
+        if ( gamedata->connected  >  0)   gamedata->connected--;
+    }  else  {
+        again  =  0;
+    }
+    pthread_mutex_unlock( &gamedata->gamemutex);
+    if ( counted)  sem_post( &gamedata->schedsem);
 
-            sem_post( &gamedata->schedsem);
-            
-            pthread_mutex_lock( &gamedata->gamemutex);
-            if ( checkwin( gamedata->players[playerid].symbol))  {
-                 gamedata->winner   =  playerid;
-                 gamedata->gameover  =  1;
+    printf( "[Child %d] %s after game %d.\n",   playerid,  again  ?  "Staying for a rematch"  :   "Leaving",  gamenumber);
+    fflush( stdout);
+    return  again;
+}
 
-                 printf( "[Game] Player %d (%s) WINS!\n",   playerid,  gamedata->players[playerid].name);  fflush( stdout);
-                 send( socketfd,  MSG_WIN,  strlen( MSG_WIN),   0);
-                 
-                 pthread_mutex_unlock( &gamedata->gamemutex);
-                 break;
-            }
-            pthread_mutex_unlock( &gamedata->gamemutex);
-            continue;
-        }  else if ( result  ==  -1  &&   errno  ==  ETIMEDOUT)  {
-             pthread_mutex_lock( &gamedata->gamemutex);
-             if ( gamedata->gameover)  {
-                 int  winnerid  =  gamedata->winner;
-                 pthread_mutex_unlock( &gamedata->gamemutex);
-                 
-                 if ( winnerid   ==  playerid)  {
-                     send( socketfd,  MSG_WIN,  strlen( MSG_WIN),   0);
-                 }  else if ( winnerid  ==  -1)  {
-                     send( socketfd,   MSG_DRAW,  strlen( MSG_DRAW),  0);
-                 }  else  {
-                     send( socketfd,  MSG_LOSE,   strlen( MSG_LOSE),  0);
-                 }
-                 break;
-             }
-             pthread_mutex_unlock( &gamedata->gamemutex);
+int  receivejoin( char  *buffer)  {
+    int  length  =  0;
+    time_t  deadline  =  time( NULL)  +  ADMISSION_JOIN_DEADLINE;
+    while ( !memchr( buffer,  '\n',   length))  {
+        int  remaining  =  deadline  -  time( NULL);
+        if ( remaining  <=  0  ||  length  >=  BUFFER_SIZE  -   1)  return  -1;
+        int  ready  =  transportwait( &connection,   0,  remaining  *  1000);
+        if ( ready  <  0)  return  -1;
+        if ( ready  ==  0)   continue;
+        ssize_t  count  =  transportrecv( &connection,  buffer  +  length,   BUFFER_SIZE  -  1  -  length);
+        if ( count  <=  0)  return  -1;
+        length  +=   count;
+    }
+    return  strncmp( buffer,  MSG_JOIN,   strlen( MSG_JOIN))  ==  0  ?  0  :  -1;
+}
 
-            continue;
+void  abandonclient( int  playerid,   const char  *reason)  {
+    dropplayer( playerid,   reason);
+    transportclose( &connection);
+    publishload();
+    _exit( 0);
+}
+
+void  handleclient( int  socketfd,   int  kind,  int  playerid)  {
+    char  buffer[ BUFFER_SIZE];
+    transportattach( &connection,  kind,   socketfd);
+    if ( kind  ==  TRANSPORT_RING  &&  transportoffer( &connection,   socketfd)  ==  -1)  {
+        logerror( "handleclient",   "ring setup failed - cannot offer shared memory to client");
+        abandonclient( playerid,   "Ring transport unavailable");
+    }
+    output.connection  =  &connection;
+    uint32_t  lastseq  =  __atomic_load_n( &gamedata->turnwords[ playerid  /  SEATS_PER_WORD],   __ATOMIC_ACQUIRE);
+    turnmessage  =  malloc( turnmessagesize()   +  1);
+    if ( !turnmessage)  {
+        logerror( "handleclient",   "malloc failed - cannot build turn messages");
+        exitwitherror( "malloc");
+    }
+    
+    memset( buffer,  0,   BUFFER_SIZE);
+    if ( receivejoin( buffer)  ==  -1)  abandonclient( playerid,   "Client did not send JOIN");
+
+    TRACE_BEGIN( pacingstart);
+    sleep( 1);
+    TRACE_END( TRACE_WELCOME_WAIT,  pacingstart,   playerid);
+    TRACE_BEGIN( welcomestart);
+    const char  *welcome  =  "WELCOME\n";
+    sendplayer( playerid,   welcome,  strlen( welcome));
+
+    memset( buffer,  0,   BUFFER_SIZE);
+    if ( transportrecv( &connection,  buffer,  BUFFER_SIZE   -  1)  <=  0)  abandonclient( playerid,   "Client dropped before sending a name");
+    TRACE_END( TRACE_WELCOME,  welcomestart,   playerid);
+    
+    pthread_mutex_lock( &gamedata->gamemutex);
+    strncpy( gamedata->players[playerid].name,   buffer,  31);
+    pthread_mutex_unlock( &gamedata->gamemutex);
+    
+    printf( "[Server] Player %d joined: %s\n",   playerid,  buffer);  fflush( stdout);
+    addtolog( "Player joined");
+    
+    while ( gamedata->game.active[playerid])  {
+        if ( playsession( playerid,   buffer,  &lastseq)  ==  -1)   break;
+        if ( offerrematch( playerid,   buffer)  ==  0)  break;
+    }
+    
+    drainoutput( &output);
+    __atomic_sub_fetch( &gamedata->queuedbytes,   output.length,  __ATOMIC_RELAXED);
+    transportclose( &connection);
+    
+    pthread_mutex_lock( &gamedata->gamemutex);
+    if ( gamedata->game.active[playerid])  {
+        enginedrop( &gamedata->game,   playerid);
+        if ( gamedata->connected  >  0)   gamedata->connected--;
+    }
+    pthread_mutex_unlock( &gamedata->gamemutex);
+    publishload();
+
+    printf( "Child Process for Player %d Exiting. (Connected: %d)\n",   playerid,  gamedata->connected);
+    exit( 0);
+}
+
+SharedBuffer  *encodeupdate()  {
+    SharedBuffer  *update  =  malloc( sizeof( SharedBuffer)   +  BUFFER_SIZE  +  enginerendersize( &gamedata->game));
+    if ( !update)  return  NULL;
+    update->refcount  =  1;
+
+    pthread_mutex_lock( &gamedata->gamemutex);
+    int  sequence  =  gamedata->updateseq;
+    int  position  =  snprintf( update->data,  BUFFER_SIZE,   "%s %d %d %d ",  MSG_UPDATE,   sequence,  gamedata->game.boardsize,   gamedata->game.cellwidth);
+    if ( !gamedata->started)  {
+        position  +=  snprintf( update->data  +  position,   BUFFER_SIZE  -  position,  "WAITING %d\n",   gamedata->connected);
+    }  else if ( gamedata->game.gameover  &&  gamedata->game.winner  >=  0)  {
+        position  +=  snprintf( update->data  +  position,   BUFFER_SIZE  -  position,  "WIN %s\n",   gamedata->players[ gamedata->game.winner].name);
+    }  else if ( gamedata->game.gameover)  {
+        position  +=  snprintf( update->data  +  position,   BUFFER_SIZE  -  position,  "DRAW\n");
+    }  else  {
+        char  identifier[ 8];
+        engineidentifier( &gamedata->game,   gamedata->game.currentturn,  identifier);
+        position  +=  snprintf( update->data  +  position,   BUFFER_SIZE  -  position,  "TURN %s %s",   identifier,  gamedata->players[ gamedata->game.currentturn].name);
+        int  threats  =  formatthreats( update->data  +  position  +   strlen( " " MSG_THREATS),  BUFFER_SIZE  -  position  -  strlen( " " MSG_THREATS)   -  1,  gamedata->game.winlength  -  1);
+        if ( threats  >  0)  {
+            memcpy( update->data  +  position,   " " MSG_THREATS,  strlen( " " MSG_THREATS));
+            position  +=  strlen( " " MSG_THREATS)  +   threats;
         }
+        update->data[position++]  =  '\n';
+    }
+    position  +=  enginerender( &gamedata->game,   update->data  +  position);
+    pthread_mutex_unlock( &gamedata->gamemutex);
 
-        send( socketfd,  MSG_YOUR_TURN,  strlen( MSG_YOUR_TURN),   0);
-        usleep( 100000);
-        char  boardstring[ BOARD_SIZE  *  BOARD_SIZE   +  BOARD_SIZE  +  1];
-        int  position  =  0;
-        pthread_mutex_lock( &gamedata->gamemutex);
-        for( int row=0;   row<BOARD_SIZE;  row++)  {
-            for( int col=0;  col<BOARD_SIZE;   col++)  {
-                boardstring[position++]  =  gamedata->board[row][col];
-            }
-            boardstring[position++]  =  '\n';
+    update->length  =  position;
+    return  update;
+}
+
+void  releasebuffer( SharedBuffer  *update)  {
+    if ( update  &&  --update->refcount  ==  0)  free( update);
+}
+
+void  queueupdate( Spectator  *spectator,   SharedBuffer  *update)  {
+    if ( spectator->count  >=  SPECTATOR_HIGH_WATER)  spectator->congested  =   1;
+    else if ( spectator->count  <=  SPECTATOR_LOW_WATER)  spectator->congested  =  0;
+
+    if ( spectator->congested)  {
+        int  keep  =  spectator->offset  >  0  ?  1  :   0;
+        while ( spectator->count  >  keep)  {
+            int  last  =  ( spectator->head  +  spectator->count  -  1)   %  SPECTATOR_QUEUE;
+            __atomic_sub_fetch( &gamedata->queuedbytes,   spectator->queue[last]->length,  __ATOMIC_RELAXED);
+            releasebuffer( spectator->queue[last]);
+            spectator->count--;
+            __atomic_add_fetch( &gamedata->coalescedupdates,   1,  __ATOMIC_RELAXED);
         }
-        boardstring[position]   =  '\0';
-        pthread_mutex_unlock( &gamedata->gamemutex);
-        sleep( 1); 
-        send( socketfd,   boardstring,  strlen( boardstring),  0);
+    }
 
-        int  validmove  =  0;
-        int  disconnected  =  0;
-        while ( !validmove)  {
-            memset( buffer,  0,   BUFFER_SIZE);
-            if ( read( socketfd,  buffer,  BUFFER_SIZE)   <=  0)  {
-                 char  errormessage[ 128];
-                 snprintf( errormessage,  128,  "Client dropped during turn - Player %d (socketfd=%d)",   playerid,  socketfd);
-                 logerror( "handleclient",  errormessage);
-                 addtolog( "DISCONNECT: Client dropped during turn.");
-                 
-                 pthread_mutex_lock( &gamedata->gamemutex);
-                 gamedata->players[playerid].active  =  0;
-                 if ( gamedata->connected   >  0)  gamedata->connected--;
-                 pthread_mutex_unlock( &gamedata->gamemutex);
-                 
-                 sem_post( &gamedata->schedsem);
-                 disconnected   =  1;
-                 break;
-            }
+    if ( spectator->count  ==  SPECTATOR_QUEUE)  {
+        __atomic_add_fetch( &gamedata->droppedupdates,   1,  __ATOMIC_RELAXED);
+        return;
+    }
+    int  slot  =  ( spectator->head  +  spectator->count)   %  SPECTATOR_QUEUE;
+    spectator->queue[slot]  =  update;
+    spectator->count++;
+    update->refcount++;
+    __atomic_add_fetch( &gamedata->queuedbytes,   update->length,  __ATOMIC_RELAXED);
+}
 
-            if ( strstr( buffer,   "TIMEOUT"))  {
-                 printf( "[Child %d] Received Client TIMEOUT signal. Skipping move processing.\n",   playerid);
-                 validmove  =  1;
-                 continue;
-            }
+int  flushspectator( Spectator  *spectator)  {
+    while ( spectator->count  >  0)  {
+        SharedBuffer  *update  =  spectator->queue[ spectator->head];
+        ssize_t  sent  =  send( spectator->fd,   update->data  +  spectator->offset,  update->length  -   spectator->offset,  MSG_NOSIGNAL  |  MSG_DONTWAIT);
+        if ( sent  <  0)  {
+            return  ( errno  ==  EAGAIN  ||  errno  ==  EWOULDBLOCK)   ?  0  :  -1;
+        }
+        spectator->offset  +=  sent;
+        __atomic_sub_fetch( &gamedata->queuedbytes,   sent,  __ATOMIC_RELAXED);
+        if ( spectator->offset  <  update->length)  return  0;
+
+        releasebuffer( update);
+        spectator->offset  =  0;
+        spectator->head  =  ( spectator->head  +  1)   %  SPECTATOR_QUEUE;
+        spectator->count--;
+    }
+    return  0;
+}
 
-            pthread_mutex_lock( &gamedata->gamemutex);
-            int  thisturn  =   gamedata->currentturn;
-            pthread_mutex_unlock( &gamedata->gamemutex);
+void  dropspectator( Spectator  *spectator)  {
+    while ( spectator->count  >  0)  {
+        SharedBuffer  *update  =  spectator->queue[ spectator->head];
+        __atomic_sub_fetch( &gamedata->queuedbytes,   update->length  -  spectator->offset,  __ATOMIC_RELAXED);
+        releasebuffer( update);
+        spectator->offset  =  0;
+        spectator->head  =  ( spectator->head  +  1)   %  SPECTATOR_QUEUE;
+        spectator->count--;
+    }
+    close( spectator->fd);
+}
 
-            if ( thisturn  !=  playerid)  {
-                 printf( "[Child %d] Move rejected - TIMEOUT (Turn moved to %d)\n",  playerid,   thisturn);
-                 send( socketfd,  "*** TIMEOUT! Your turn was skipped. ***\n",   40,  0);
-                 validmove  =  1;
-                 continue;
-            }
+void  *spectatorthread( void  *arg)  {
+    int  listenfd  =  *( int  *)arg;
+    spectators  =  calloc( SPECTATOR_MAX,   sizeof( Spectator));
+    struct pollfd  *pollfds  =  calloc( SPECTATOR_MAX  +  2,   sizeof( struct pollfd));
+    spectatorcount  =  0;
+    SharedBuffer  *latest  =  encodeupdate();
 
-            int  row,   col;
-            if ( sscanf( buffer,  "%d %d",  &row,   &col)  ==  2)  {
-                pthread_mutex_lock( &gamedata->gamemutex);
-                if ( row  >=  0  &&  row  <  BOARD_SIZE  &&   col  >=  0  &&  col  <  BOARD_SIZE  &&  gamedata->board[row][col]  ==  ' ')  {
-                    gamedata->board[row][col]   =  gamedata->players[playerid].symbol;
-                    validmove  =  1;
-                    char  logmessage[ 64];
-                    snprintf( logmessage,  64,  "MOVE: Player %s placed %c at %d,%d",  gamedata->players[playerid].name,   gamedata->players[playerid].symbol,  row,  col);
-                    printf( "[Child %d] %s\n",  playerid,  logmessage);   fflush( stdout);
-                    pthread_mutex_unlock( &gamedata->gamemutex); 
-                    addtolog( logmessage);
-                }  else  {
-                    pthread_mutex_unlock( &gamedata->gamemutex);
+    printf( "[Spectator Thread] Started on port %d.\n",   port  +  SPECTATOR_PORT_OFFSET  +  shardid);
+
+    while ( !gamedata->stopflag)  {
+        pollfds[0].fd  =  listenfd;
+        pollfds[0].events   =  POLLIN;
+        pollfds[1].fd  =  updatefd;
+        pollfds[1].events   =  POLLIN;
+        for ( int i  =  0;   i  <  spectatorcount;  i++)  {
+            pollfds[i  +  2].fd  =   spectators[i].fd;
+            pollfds[i  +  2].events  =  spectators[i].count  >  0  ?  POLLOUT  :   POLLIN;
+        }
+
+        if ( poll( pollfds,  spectatorcount  +  2,   1000)  <  0)  {
+            if ( errno  !=  EINTR)  perror( "poll");
+            continue;
+        }
+
+        if ( pollfds[1].revents  &  POLLIN)  {
+            uint64_t  updates;
+            if ( read( updatefd,  &updates,   sizeof( updates))  >  0)  {
+                SharedBuffer  *update  =  encodeupdate();
+                if ( update)  {
+                    releasebuffer( latest);
+                    latest  =  update;
+                    for ( int i  =  0;   i  <  spectatorcount;  i++)  queueupdate( &spectators[i],   latest);
                 }
             }
+        }
 
-            if ( validmove)  send( socketfd,  MSG_VALID_MOVE,  strlen( MSG_VALID_MOVE),   0);
-            else  send( socketfd,  MSG_INVALID_MOVE,  strlen( MSG_INVALID_MOVE),   0);
+        for ( int i  =  spectatorcount  -  1;   i  >=  0;  i--)  {
+            short  revents  =  pollfds[i  +  2].revents;
+            int  dead  =  ( revents  &  ( POLLERR  |  POLLHUP  |  POLLNVAL))   !=  0;
+            if ( !dead  &&  ( revents  &  POLLIN))  {
+                char  discard[ 64];
+                dead  =  recv( spectators[i].fd,   discard,  sizeof( discard),  MSG_DONTWAIT)   ==  0;
+            }
+            if ( !dead)  dead  =  flushspectator( &spectators[i])   ==  -1;
+            if ( dead)  {
+                dropspectator( &spectators[i]);
+                spectators[i]  =  spectators[ --spectatorcount];
+            }
         }
 
-        if ( disconnected)  break;
+        if ( pollfds[0].revents  &  POLLIN)  {
+            int  newsocket;
+            while ( ( newsocket  =  accept4( listenfd,  NULL,   NULL,  SOCK_NONBLOCK  |  SOCK_CLOEXEC))  >=  0)  {
+                if ( spectatorcount  ==  SPECTATOR_MAX)  {
+                    close( newsocket);
+                    continue;
+                }
+                Spectator  *spectator  =  &spectators[ spectatorcount++];
+                memset( spectator,  0,   sizeof( Spectator));
+                spectator->fd  =  newsocket;
+                if ( latest)  queueupdate( spectator,   latest);
+                flushspectator( spectator);
+                addtolog( "SPECTATOR: Spectator joined.");
+            }
+        }
+    }
 
-        sem_post( &gamedata->schedsem);
-        
-        pthread_mutex_lock( &gamedata->gamemutex);
-        if ( checkwin( gamedata->players[playerid].symbol))  {
-             gamedata->winner  =  playerid;
-             gamedata->gameover   =  1;
+    for ( int i  =  0;   i  <  spectatorcount;  i++)  dropspectator( &spectators[i]);
+    spectatorcount  =  0;
+    releasebuffer( latest);
+    free( spectators);
+    free( pollfds);
+    return  NULL;
+}
 
-             printf( "[Game] Player %d (%s) WINS!\n",  playerid,  gamedata->players[playerid].name);   fflush( stdout);
-             send( socketfd,  MSG_WIN,  strlen( MSG_WIN),  0);
-             
-             pthread_mutex_unlock( &gamedata->gamemutex);
-             break;
+int  handoffclient( int  socketfd,   int  kind)  {
+    if ( !shardtable)  return  0;
+
+    int  target  =  -1;
+    int  bestseats  =  0;
+    for ( int i  =  0;   i  <  shardcount;  i++)  {
+        int  openseats  =  __atomic_load_n( &shardtable[i].openseats,   __ATOMIC_RELAXED);
+        if ( i  !=  shardid  &&  openseats  >  bestseats)  {
+            bestseats  =   openseats;
+            target  =  i;
         }
-        pthread_mutex_unlock( &gamedata->gamemutex);
     }
-    
+    if ( target  ==  -1)  return  0;
+
+    char  control[ CMSG_SPACE( sizeof( int))];
+    char  tag  =  kind;
+    struct iovec  vector  =  { &tag,   1};
+    struct msghdr  message;
+    memset( &message,  0,   sizeof( message));
+    memset( control,   0,  sizeof( control));
+    message.msg_iov  =  &vector;
+    message.msg_iovlen  =   1;
+    message.msg_control  =  control;
+    message.msg_controllen   =  sizeof( control);
+
+    struct cmsghdr  *header  =  CMSG_FIRSTHDR( &message);
+    header->cmsg_level  =  SOL_SOCKET;
+    header->cmsg_type   =  SCM_RIGHTS;
+    header->cmsg_len  =  CMSG_LEN( sizeof( int));
+    memcpy( CMSG_DATA( header),   &socketfd,  sizeof( int));
+
+    if ( sendmsg( shardtable[target].handoff[1],  &message,   MSG_DONTWAIT)  <  0)  return  0;
+
+    printf( "[Shard %d] Handed connection off to shard %d (%d open seats).\n",   shardid,  target,  bestseats);
+    fflush( stdout);
+    return  1;
+}
+
+int  receivehandoff( int  handofffd,   int  *kind)  {
+    char  control[ CMSG_SPACE( sizeof( int))];
+    char  tag;
+    struct iovec  vector  =  { &tag,   1};
+    struct msghdr  message;
+    memset( &message,  0,   sizeof( message));
+    message.msg_iov  =  &vector;
+    message.msg_iovlen  =   1;
+    message.msg_control  =  control;
+    message.msg_controllen   =  sizeof( control);
+
+    if ( recvmsg( handofffd,  &message,   MSG_CMSG_CLOEXEC)  <=  0)  return  -1;
+
+    struct cmsghdr  *header  =  CMSG_FIRSTHDR( &message);
+    if ( !header  ||  header->cmsg_type   !=  SCM_RIGHTS)  return  -1;
+
+    int  socketfd;
+    memcpy( &socketfd,   CMSG_DATA( header),  sizeof( int));
+    *kind  =  tag  >=  TRANSPORT_TCP  &&  tag  <=  TRANSPORT_RING  ?  tag   :  TRANSPORT_TCP;
+    return  socketfd;
+}
+
+int  takeadmission( int  *retryms)  {
+    if ( admissionrate  <=  0)  return  1;
+
+    double  burst  =  admissionrate  >  maxplayers  ?  admissionrate   :  maxplayers;
+    struct timespec  now;
+    clock_gettime( CLOCK_MONOTONIC,   &now);
+    if ( admissiontokens  <  0)  admissiontokens  =  burst;
+    else  admissiontokens  +=  ( ( now.tv_sec  -  admissionrefill.tv_sec)   +  ( now.tv_nsec  -  admissionrefill.tv_nsec)  /  1e9)   *  admissionrate;
+    if ( admissiontokens  >  burst)  admissiontokens  =   burst;
+    admissionrefill  =  now;
+
+    if ( admissiontokens  >=  1)  {
+        admissiontokens--;
+        return  1;
+    }
+    *retryms  =  ( 1  -  admissiontokens)  *  1000  /  admissionrate   +  1;
+    return  0;
+}
+
+void  rejectclient( int  socketfd,   const char  *reason,  int  retryms)  {
+    char  discard[ 64];
+    char  reply[ 64];
+    while ( recv( socketfd,  discard,   sizeof( discard),  MSG_DONTWAIT)  >  0);
+    int  length  =  snprintf( reply,   sizeof( reply),  "%s %s %d\n",  MSG_BUSY,   reason,  retryms);
+    if ( send( socketfd,  reply,   length,  MSG_NOSIGNAL  |  MSG_DONTWAIT)  <  0)  {}
+    shutdown( socketfd,   SHUT_WR);
     close( socketfd);
-    
+    printf( "[Server] Rejected connection: %s, retry after %d ms.\n",   reason,  retryms);
+}
+
+void  closeinherited( int  keepfd)  {
+    for ( int i  =  0;   i  <  3;  i++)  {
+        if ( listenfds[i]  !=  -1)  close( listenfds[i]);
+    }
+    if ( spectatorlistenfd  !=  -1)  close( spectatorlistenfd);
+    for ( int i  =  0;   spectators  &&  i  <  spectatorcount;  i++)  {
+        if ( spectators[i].fd  !=  keepfd)  close( spectators[i].fd);
+    }
+    for ( int i  =  0;   shardtable  &&  i  <  shardcount;  i++)  {
+        close( shardtable[i].handoff[0]);
+        close( shardtable[i].handoff[1]);
+    }
+    if ( federationfd  !=  -1)   close( federationfd);
+}
+
+void  admitclient( int  newsocket,   int  kind,  int  allowhandoff)  {
     pthread_mutex_lock( &gamedata->gamemutex);
-    gamedata->players[playerid].active   =  0;
-    if ( gamedata->connected  >  0)   gamedata->connected--;
+    
+    int  connectedcount  =  gamedata->connected;
+    
+    if ( connectedcount  <  maxplayers   &&  !gamedata->started)  {
+         int  id  =  gamedata->game.playercount;
+         if ( gamedata->game.playercount  <  maxplayers)  {
+             gamedata->game.playercount++;
+         }  else  {
+             int  freeslot   =  -1;
+             for( int i=0;  i<maxplayers;   i++)  {
+                 if ( !gamedata->game.active[i])  {
+                     freeslot  =  i;
+                     break;
+                 }
+             }
+             id   =  freeslot;
+         }
+
+         if ( id  !=  -1)  {
+             gamedata->game.active[id]   =  1;
+             memset( &gamedata->players[id],  0,   sizeof( Player));
+             gamedata->connected++;
+             pthread_mutex_unlock( &gamedata->gamemutex);
+             publishload();
+
+             TRACE_BEGIN( forkstart);
+             pid_t  childpid  =  fork();
+             if ( childpid   ==  0)  {
+                 TRACE_THREAD( "player",  id);
+                 signal( SIGINT,  SIG_DFL);
+                 closeinherited( newsocket);
+                 handleclient( newsocket,   kind,  id);
+                 exit( 0);
+             }  else if ( childpid  <  0)  {
+                 logerror( "main",   "fork() failed - cannot create child process for client");
+                 perror( "Fork failed");
+             }  else  {
+                 TRACE_END( TRACE_FORK,  forkstart,   id);
+                 close( newsocket);
+                 printf( "[Server Debug] Parent: Closed socket for Child %d, returning to Accept loop.\n",   id);
+                 fflush( stdout);
+             }
+             return;
+         }
+    }
     pthread_mutex_unlock( &gamedata->gamemutex);
 
-    printf( "Child Process for Player %d Exiting. (Connected: %d)\n",   playerid,  gamedata->connected);
-    exit( 0);
+    if ( allowhandoff  &&  handoffclient( newsocket,   kind))  {
+         close( newsocket);
+         return;
+    }
+    rejectclient( newsocket,   gamedata->started  ?  "IN_PROGRESS"  :  "FULL",   ADMISSION_RETRY_FULL_MS);
 }
 
 void  signalhandler( int  signal)  {
     if ( signal  ==  SIGINT)  {
-        printf( "\n[Server] Shutting down...\n");
-        if ( gamedata)  {
-            saveallscores();
-            gamedata->stopflag   =  1;
-            shm_unlink( SHM_NAME);
-        }
-        exit( 0);
+        stopping  =  1;
+        if ( gamedata)  gamedata->stopflag   =  1;
     }
     if ( signal   ==  SIGCHLD)  {
         while( waitpid( -1,  NULL,  WNOHANG)   >  0);
     }
 }
 
-int  main( int  argc,  char  *argv[])  {
-    signal( SIGINT,   signalhandler);
-    signal( SIGCHLD,  signalhandler);
-    
-    srand( time( NULL));
-
-    if ( argc  >  1)  {
-        port  =  atoi( argv[1]);
+void  shutdownshard( pthread_t  logthread)  {
+    printf( "\n[Server] Shutting down...\n");
+    saveallscores();
+    gamedata->stopflag  =  1;
+    pthread_join( logthread,  NULL);
+    shm_unlink( shmname);
+    if ( shardid  ==  0)  {
+        char  path[ 108];
+        transportpath( TRANSPORT_UNIX,  port,   path,  sizeof( path));
+        unlink( path);
+        transportpath( TRANSPORT_RING,   port,  path,  sizeof( path));
+        unlink( path);
     }
+    exit( 0);
+}
 
-    printf( "[Server] Starting Mega Tic-Tac-Toe Server on port %d...\n",   port);
-
-    setupsharedmemory();
-    loadscores();
-
-    pthread_t  logthread,   schedthread;
-    pthread_create( &logthread,  NULL,   loggerthread,  NULL);
-    pthread_create( &schedthread,  NULL,  schedulerthread,   NULL);
-
-    int  listenfd,  newsocket;
+int  openlistener( int  listenport,   int  deferaccept)  {
+    int  listenfd;
     struct sockaddr_in  serveraddr;
-    int  addrlen   =  sizeof( serveraddr);
 
-    if ( ( listenfd  =  socket( AF_INET,  SOCK_STREAM,   0))  ==  0)  {
+    if ( ( listenfd  =  socket( AF_INET,  SOCK_STREAM  |  SOCK_CLOEXEC,   0))  <  0)  {
         logerror( "main",   "socket() failed - cannot create listening socket");
         exitwitherror( "socket failed");
     }
@@ -708,79 +1984,214 @@ int  main( int  argc,  char  *argv[])  {
         logerror( "main",  "setsockopt() failed - cannot set socket options");
         exitwitherror( "setsockopt");
     }
+    if ( shardcount  >  1  &&  setsockopt( listenfd,   SOL_SOCKET,  SO_REUSEPORT,  &option,   sizeof( option)))  {
+        logerror( "main",  "setsockopt(SO_REUSEPORT) failed - cannot share port between shards");
+        exitwitherror( "setsockopt");
+    }
 
+    memset( &serveraddr,   0,  sizeof( serveraddr));
     serveraddr.sin_family  =  AF_INET;
     serveraddr.sin_addr.s_addr   =  INADDR_ANY;
-    serveraddr.sin_port  =  htons( port);
+    serveraddr.sin_port  =  htons( listenport);
 
     if ( bind( listenfd,  ( struct sockaddr  *)&serveraddr,   sizeof( serveraddr))  <  0)  {
         char  errormessage[ 64];
-        snprintf( errormessage,  64,  "bind() failed on port %d - Address may be in use",   port);
+        snprintf( errormessage,  64,  "bind() failed on port %d - Address may be in use",   listenport);
         logerror( "main",  errormessage);
         exitwitherror( "bind failed");
     }
-    if ( listen( listenfd,  MAX_PLAYERS)   <  0)  {
+    int  defersecs  =  ADMISSION_DEFER_SECS;
+    if ( deferaccept  &&  setsockopt( listenfd,   IPPROTO_TCP,  TCP_DEFER_ACCEPT,  &defersecs,   sizeof( defersecs)))  {
+        logerror( "main",  "setsockopt(TCP_DEFER_ACCEPT) failed - accepting connections before JOIN");
+    }
+    if ( listen( listenfd,  backlog)   <  0)  {
         logerror( "main",   "listen() failed - cannot start listening");
         exitwitherror( "listen");
     }
+    fcntl( listenfd,  F_SETFL,   O_NONBLOCK);
+    return  listenfd;
+}
+
+void  pinshard()  {
+    long  cpucount  =  sysconf( _SC_NPROCESSORS_ONLN);
+    if ( cpucount  <  1)   return;
+
+    cpu_set_t  cpuset;
+    CPU_ZERO( &cpuset);
+    CPU_SET( ( firstcpu  +  shardid)  %  cpucount,   &cpuset);
+    if ( sched_setaffinity( 0,  sizeof( cpuset),   &cpuset)  ==  -1)  {
+        logerror( "pinshard",   "sched_setaffinity failed - shard left unpinned");
+        return;
+    }
+    printf( "[Shard %d] Pinned to CPU %ld.\n",   shardid,  ( firstcpu  +  shardid)  %  cpucount);
+}
+
+void  runshard()  {
+    if ( shardcount  >  1)  {
+        snprintf( shmname,  sizeof( shmname),   "%s_%d",  SHM_NAME,  shardid);
+    }
+    if ( firstcpu  >=  0)  pinshard();
+
+    setupsharedmemory();
+    char  tracename[ 64]  =  TRACE_SHM_NAME;
+    if ( shardcount  >  1)  snprintf( tracename,  sizeof( tracename),   "%s_%d",  TRACE_SHM_NAME,  shardid);
+    TRACE_OPEN( tracename,  &gamedata->gamenumber);
+    TRACE_THREAD( "accept",  shardcount  >  1  ?  shardid   :  -1);
+    loadscores();
+    openhistory();
+    publishload();
+
+    updatefd  =  eventfd( 0,   EFD_NONBLOCK  |  EFD_CLOEXEC);
+    if ( updatefd  ==  -1)  {
+        logerror( "runshard",   "eventfd failed - spectators will not receive updates");
+    }
+
+    pthread_t  logthread,   schedthread,  spectthread;
+    pthread_create( &logthread,  NULL,   loggerthread,  NULL);
+    pthread_create( &schedthread,  NULL,  schedulerthread,   NULL);
+    if ( coordinatorport  !=  -1)  {
+        pthread_t  fedthread;
+        pthread_create( &fedthread,  NULL,   federationthread,  NULL);
+    }
+    if ( shardid  ==  0  &&  historyfd  !=  -1)  {
+        pthread_t  ratethread;
+        pthread_create( &ratethread,  NULL,   ratingthread,  NULL);
+    }
+
+    listenfds[TRANSPORT_TCP]  =  openlistener( port,   1);
+    if ( shardid  ==  0)  {
+        for ( int kind  =  TRANSPORT_UNIX;   kind  <=  TRANSPORT_RING;  kind++)  {
+            char  path[ 108];
+            transportpath( kind,  port,   path,  sizeof( path));
+            listenfds[kind]  =  transportlisten( path,   backlog);
+            if ( listenfds[kind]  ==  -1)  {
+                char  errormessage[ 160];
+                snprintf( errormessage,  sizeof( errormessage),   "cannot listen on %s - %s transport disabled",  path,   transportname( kind));
+                logerror( "runshard",  errormessage);
+                continue;
+            }
+            fcntl( listenfds[kind],  F_SETFL,   O_NONBLOCK);
+        }
+    }
+    spectatorlistenfd  =  openlistener( port  +  SPECTATOR_PORT_OFFSET  +   shardid,  0);
+    pthread_create( &spectthread,  NULL,   spectatorthread,  &spectatorlistenfd);
+    int  handofffd  =  shardtable  ?  shardtable[shardid].handoff[0]  :  -1;
 
     printf( "[Server] Waiting for connections...\n");
 
-    while ( 1)  {
-        if ( ( newsocket  =  accept( listenfd,  ( struct sockaddr  *)&serveraddr,   ( socklen_t*)&addrlen))  <  0)  {
+    while ( !stopping)  {
+        struct pollfd  pollfds[4]  =  { { listenfds[0],   POLLIN,  0},  { listenfds[1],  POLLIN,   0},
+                                     { listenfds[2],  POLLIN,   0},  { handofffd,  POLLIN,   0}};
+        if ( poll( pollfds,  4,   1000)  <  0)  {
            if ( errno  ==  EINTR)   continue;
-           perror( "accept");
+           perror( "poll");
            continue;
         }
 
-        pthread_mutex_lock( &gamedata->gamemutex);
-        
-        int  connectedcount  =  gamedata->connected;
-        
-        if ( connectedcount  <  MAX_PLAYERS   &&  !gamedata->started)  {
-             int  id  =  gamedata->playercount;
-             if ( gamedata->playercount  <  MAX_PLAYERS)  {
-                 gamedata->playercount++;
-             }  else  {
-                 int  freeslot   =  -1;
-                 for( int i=0;  i<MAX_PLAYERS;   i++)  {
-                     if ( !gamedata->players[i].active)  {
-                         freeslot  =  i;
-                         break;
-                     }
-                 }
-                 id   =  freeslot;
-             }
+        if ( handofffd  >=  0  &&  ( pollfds[3].revents  &  POLLIN))  {
+            int  kind;
+            int  newsocket  =  receivehandoff( handofffd,   &kind);
+            if ( newsocket  >=  0)  admitclient( newsocket,   kind,  0);
+        }
 
-             if ( id  !=  -1)  {
-                 gamedata->players[id].active   =  1;
-                 gamedata->connected++;
-                 pthread_mutex_unlock( &gamedata->gamemutex);
-
-                 pid_t  childpid  =  fork();
-                 if ( childpid   ==  0)  {
-                     close( listenfd);
-                     handleclient( newsocket,  id);
-                     exit( 0);
-                 }  else if ( childpid  <  0)  {
-                     logerror( "main",   "fork() failed - cannot create child process for client");
-                     perror( "Fork failed");
-                 }  else  {
-                     close( newsocket);
-                     printf( "[Server Debug] Parent: Closed socket for Child %d, returning to Accept loop.\n",   id);
-                     fflush( stdout);
-                 }
-             }  else  {
-                 pthread_mutex_unlock( &gamedata->gamemutex);
-                 close( newsocket);
-                 printf( "[Server] Rejected connection: Full.\n");
-             }
-        }  else  {
-             pthread_mutex_unlock( &gamedata->gamemutex);
-             close( newsocket);
-             printf( "[Server] Rejected connection: Game in progress or Full.\n");
+        for ( int kind  =  TRANSPORT_TCP;   kind  <=  TRANSPORT_RING;  kind++)  {
+            if ( !( pollfds[kind].revents  &  POLLIN))   continue;
+            for ( int accepted  =  0;   accepted  <  ADMISSION_BATCH;  accepted++)  {
+                int  newsocket  =  accept4( listenfds[kind],  NULL,   NULL,  SOCK_CLOEXEC);
+                if ( newsocket  <  0)  {
+                   if ( errno  ==  EINTR  ||  errno   ==  ECONNABORTED)  continue;
+                   if ( errno  !=  EAGAIN  &&  errno   !=  EWOULDBLOCK)  perror( "accept4");
+                   break;
+                }
+                TRACE_MARK( TRACE_ACCEPT,  newsocket);
+                int  retryms;
+                if ( takeadmission( &retryms))  admitclient( newsocket,   kind,  1);
+                else  rejectclient( newsocket,   "RATE",  retryms);
+            }
+        }
+    }
+    shutdownshard( logthread);
+}
+
+void  startshards()  {
+    shardtable  =  mmap( NULL,   shardcount  *  sizeof( ShardInfo),  PROT_READ  |  PROT_WRITE,   MAP_SHARED  |  MAP_ANONYMOUS,  -1,  0);
+    if ( shardtable  ==  MAP_FAILED)  {
+        logerror( "startshards",   "mmap failed - cannot create shard table");
+        exitwitherror( "mmap");
+    }
+
+    for ( int i  =  0;   i  <  shardcount;  i++)  {
+        if ( socketpair( AF_UNIX,  SOCK_DGRAM  |  SOCK_CLOEXEC,   0,  shardtable[i].handoff)  ==  -1)  {
+            logerror( "startshards",   "socketpair failed - cannot create handoff channel");
+            exitwitherror( "socketpair");
+        }
+    }
+
+    fflush( stdout);
+    for ( int i  =  0;   i  <  shardcount;  i++)  {
+        pid_t  shardpid  =  fork();
+        if ( shardpid  ==  0)  {
+            shardid  =  i;
+            runshard();
+            exit( 0);
+        }  else if ( shardpid  <  0)  {
+            logerror( "startshards",   "fork() failed - cannot start shard");
+            exitwitherror( "fork");
+        }
+        shardtable[i].pid  =   shardpid;
+    }
+
+    printf( "[Server] Started %d shards on port %d.\n",   shardcount,  port);
+    while ( !stopping)  sleep( 1);
+    printf( "\n[Server] Shutting down...\n");
+    for ( int i  =  0;   i  <  shardcount;  i++)  kill( shardtable[i].pid,   SIGINT);
+    exit( 0);
+}
+
+int  main( int  argc,  char  *argv[])  {
+    signal( SIGINT,   signalhandler);
+    signal( SIGCHLD,  signalhandler);
+    
+    srand( time( NULL));
+
+    int  option;
+    while ( ( option  =  getopt( argc,  argv,   "s:c:n:b:q:r:C:"))  !=  -1)  {
+        switch ( option)  {
+            case  's':  shardcount  =  atoi( optarg);   break;
+            case  'c':  firstcpu  =   atoi( optarg);  break;
+            case  'n':  maxplayers  =  atoi( optarg);   break;
+            case  'b':  boardsize  =   atoi( optarg);  break;
+            case  'q':  backlog  =  atoi( optarg);   break;
+            case  'r':  admissionrate  =   atoi( optarg);  break;
+            case  'C':
+                if ( sscanf( optarg,  "%63[^:]:%d",   coordinatorhost,  &coordinatorport)  !=  2)  {
+                    snprintf( coordinatorhost,  sizeof( coordinatorhost),   "%s",  "127.0.0.1");
+                    coordinatorport  =  atoi( optarg);
+                }
+                break;
+            default:
+                fprintf( stderr,  "Usage: %s [-s shards] [-c firstcpu] [-n players] [-b boardsize] [-q backlog] [-r joins/sec] [-C coordinator:port] [PORT]\n",   argv[0]);
+                exit( EXIT_FAILURE);
         }
     }
+    if ( shardcount  <  1)  shardcount  =   1;
+    if ( backlog  <  1)  backlog  =  ADMISSION_BACKLOG;
+    if ( maxplayers  <  MIN_PLAYERS  ||  maxplayers   >  LOBBY_MAX_PLAYERS  ||  boardsize  <  WIN_LEN  ||   boardsize  >  LOBBY_MAX_BOARD)  {
+        fprintf( stderr,  "Players must be %d-%d and board size %d-%d.\n",   MIN_PLAYERS,  LOBBY_MAX_PLAYERS,   WIN_LEN,  LOBBY_MAX_BOARD);
+        exit( EXIT_FAILURE);
+    }
+
+    if ( optind  <  argc)  {
+        port  =  atoi( argv[optind]);
+    }
+
+    printf( "[Server] Starting Mega Tic-Tac-Toe Server on port %d (%d players, %dx%d board)...\n",   port,  maxplayers,   boardsize,  boardsize);
+
+    if ( shardcount  >  1)  {
+        startshards();
+    }  else  {
+        runshard();
+    }
 
     return  0;
 }
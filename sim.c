@@ -0,0 +1,246 @@
+#include "engine.h"
+
+#define LOBBY_WAIT_MS  15000
+#define  WELCOME_MS  1000
+#define GAME_OVER_MS   5200
+#define  THINK_MIN_MS  200
+#define THINK_MAX_MS   3000
+
+typedef  struct {
+    unsigned long long  seed;
+    long  games;
+    int  maxplayers;
+    int   boardsize;
+    GameState  state;
+    int  *empty;
+    int   disconnectrate;
+    int  verify;
+    long  wins;
+    long   draws;
+    long  deaddraws;
+    long  abandoned;
+    long  moves;
+    long   disconnects;
+    long  mismatches;
+    long long  virtualms;
+}  Worker;
+
+unsigned int  nextrandom( unsigned long long  *state)  {
+    *state  ^=  *state  >>  12;
+    *state  ^=   *state  <<  25;
+    *state  ^=  *state  >>  27;
+    return  ( unsigned int)( ( *state  *  2685821657736338717ULL)   >>  32);
+}
+
+int  pickmove( GameState  *state,   int  *empty,  int  player,  int  greedy,  unsigned long long  *rng)  {
+    int  size  =  state->boardsize;
+    int  count  =  0;
+    for ( int cell  =  0;   cell  <  size  *  size;  cell++)  {
+        if ( state->board[cell]  ==   0)  empty[count++]  =  cell;
+    }
+    if ( greedy)  {
+        for ( int i  =  0;   i  <  count;  i++)  {
+            if ( enginewinningmove( state,  player,   empty[i]  /  size,  empty[i]  %  size))   return  empty[i];
+        }
+    }
+    return  empty[ nextrandom( rng)  %  count];
+}
+
+int  rescanthreat( GameState  *state,   int  player,  int  *windows)  {
+    static const int  directions[4][2]  =  { { 0,  1},  { 1,   0},  { 1,  1},   { 1,  -1}};
+    int  size  =  state->boardsize;
+    int  longest  =  0;
+    *windows  =  0;
+    for ( int d  =  0;   d  <  4;  d++)  {
+        for ( int row  =  0;   row  <  size;  row++)  {
+            for ( int col  =  0;   col  <  size;  col++)  {
+                int  endrow  =  row  +  ( state->winlength  -  1)  *   directions[d][0];
+                int  endcol   =  col  +  ( state->winlength  -  1)  *  directions[d][1];
+                if ( endrow  >=  size  ||  endcol  <  0  ||   endcol  >=  size)  continue;
+                int  count  =  0;
+                for ( int k  =  0;   k  <  state->winlength  &&  count   !=  -1;  k++)  {
+                    int  mark  =  state->board[ ( row  +  k  *  directions[d][0])  *  size   +  col  +  k  *  directions[d][1]];
+                    if ( mark  ==  player  +  1)  count++;
+                    else if ( mark)   count  =  -1;
+                }
+                if ( count  >  longest)  {
+                    longest  =  count;
+                    *windows   =  0;
+                }
+                if ( count  ==  longest  &&  count  >   0)  ( *windows)++;
+            }
+        }
+    }
+    return  longest;
+}
+
+int  checkthreats( GameState  *state)  {
+    int  size  =  state->boardsize;
+    int  mismatches  =  0;
+    for ( int player  =  0;   player  <  state->playercount;  player++)  {
+        int  windows,   expected;
+        int  longest  =  enginethreat( state,  player,   &windows);
+        if ( longest  !=  rescanthreat( state,  player,   &expected)  ||  windows  !=  expected)  mismatches++;
+
+        int  row,   col,  winnable  =  0;
+        for ( int cell  =  0;   cell  <  size  *  size  &&  !winnable;   cell++)  {
+            winnable  =  enginewinningmove( state,  player,   cell  /  size,  cell  %  size);
+        }
+        if ( !enginehint( state,  player,   &row,  &col)  ||  ( winnable  &&  !enginewinningmove( state,   player,  row,  col)))  mismatches++;
+    }
+    return  mismatches;
+}
+
+int  linearnextplayer( GameState  *state,   int  last)  {
+    for ( int step  =  1;   step  <=  state->playercount;  step++)  {
+        int  seat  =  ( last  +  step)  %   state->playercount;
+        if ( state->active[seat])  return  seat;
+    }
+    return  -1;
+}
+
+void  playgame( Worker  *worker,   unsigned long long  *rng)  {
+    GameState  *state  =  &worker->state;
+    int  size  =  state->boardsize;
+    int  playercount  =  MIN_PLAYERS  +  nextrandom( rng)   %  ( worker->maxplayers  -  MIN_PLAYERS  +  1);
+    for ( int i  =  0;   i  <  state->maxplayers;  i++)  state->active[i]   =  i  <  playercount;
+    enginestart( state,  playercount);
+
+    long long  clock  =  WELCOME_MS;
+    if ( playercount  <  worker->maxplayers)  clock  +=   LOBBY_WAIT_MS;
+
+    int  last  =  -1;
+    while ( !state->gameover)  {
+        int  player  =  enginenextplayer( state);
+        if ( worker->verify  &&  player   !=  linearnextplayer( state,  last))  worker->mismatches++;
+        last  =  player;
+        if ( player  ==  -1)  {
+            worker->abandoned++;
+            worker->virtualms  +=  clock;
+            return;
+        }
+
+        clock  +=  THINK_MIN_MS  +  nextrandom( rng)   %  ( THINK_MAX_MS  -  THINK_MIN_MS);
+        if ( worker->disconnectrate  &&  ( int)( nextrandom( rng)   %  1000)  <  worker->disconnectrate)  {
+            enginedrop( state,  player);
+            worker->disconnects++;
+            continue;
+        }
+
+        int  cell  =  pickmove( state,   worker->empty,  player,  player  %  2,   rng);
+        int  result  =  engineplay( state,   player,  cell  /  size,  cell   %  size);
+        worker->moves++;
+        if ( !worker->verify)  {
+            if ( !state->gameover)  engineadvance( state);
+            continue;
+        }
+
+        int  oraclewin  =  enginecheckwin( state,   player);
+        int  oracledead  =  engineboardfull( state)  ||  enginecountlive( state)   ==  0;
+        if ( ( result  ==  MOVE_WIN)  !=  oraclewin  ||   ( result  ==  MOVE_DRAW)  !=  ( !oraclewin  &&  oracledead)  ||  result   ==  MOVE_INVALID)  {
+            worker->mismatches++;
+        }
+        if ( !state->gameover)  {
+            worker->mismatches  +=  checkthreats( state);
+            engineadvance( state);
+        }
+    }
+
+    if ( state->winner  >=  0)  worker->wins++;
+    else  worker->draws++;
+    if ( state->winner  <  0  &&  state->movecount   <  size  *  size)  worker->deaddraws++;
+    worker->virtualms  +=  clock  +   GAME_OVER_MS;
+}
+
+void  *workerthread( void  *arg)  {
+    Worker  *worker  =  arg;
+    unsigned long long  rng  =  worker->seed;
+    void  *memory  =  malloc( enginesize( worker->maxplayers,   worker->boardsize));
+    worker->empty  =  malloc( worker->boardsize  *   worker->boardsize  *  sizeof( int));
+    if ( !memory  ||  !worker->empty)  {
+        perror( "malloc");
+        exit( 1);
+    }
+    engineinit( &worker->state,   memory,  worker->maxplayers,  worker->boardsize,   WIN_LEN);
+
+    for ( long game  =  0;   game  <  worker->games;  game++)  {
+        playgame( worker,   &rng);
+    }
+    free( worker->empty);
+    free( memory);
+    return  NULL;
+}
+
+int  main( int  argc,   char  *argv[])  {
+    long  games  =  1000000;
+    int  threads  =  sysconf( _SC_NPROCESSORS_ONLN);
+    unsigned long long  seed  =  1;
+    int  disconnectrate  =  0;
+    int  verify  =  0;
+    int  maxplayers  =  MAX_PLAYERS;
+    int  boardsize   =  BOARD_SIZE;
+
+    int  option;
+    while ( ( option  =  getopt( argc,  argv,   "g:t:s:d:n:b:v"))  !=  -1)  {
+        switch ( option)  {
+            case  'g':  games  =  atol( optarg);   break;
+            case  't':  threads  =   atoi( optarg);  break;
+            case  's':  seed  =  strtoull( optarg,   NULL,  10);  break;
+            case  'd':  disconnectrate   =  atoi( optarg);  break;
+            case  'n':  maxplayers  =  atoi( optarg);   break;
+            case  'b':  boardsize  =   atoi( optarg);  break;
+            case  'v':  verify  =   1;  break;
+            default:
+                fprintf( stderr,  "Usage: %s [-g games] [-t threads] [-s seed] [-d disconnects per 1000 turns] [-n players] [-b boardsize] [-v]\n",   argv[0]);
+                return  1;
+        }
+    }
+    if ( threads  <  1)  threads  =   1;
+    if ( maxplayers  <  MIN_PLAYERS  ||  maxplayers   >  LOBBY_MAX_PLAYERS  ||  boardsize  <  WIN_LEN  ||   boardsize  >  LOBBY_MAX_BOARD)  {
+        fprintf( stderr,  "Players must be %d-%d and board size %d-%d.\n",   MIN_PLAYERS,  LOBBY_MAX_PLAYERS,   WIN_LEN,  LOBBY_MAX_BOARD);
+        return  1;
+    }
+
+    Worker  *workers  =  calloc( threads,   sizeof( Worker));
+    pthread_t  *handles  =  calloc( threads,   sizeof( pthread_t));
+
+    struct timespec  start,   end;
+    clock_gettime( CLOCK_MONOTONIC,  &start);
+    for ( int i  =  0;   i  <  threads;  i++)  {
+        workers[i].seed  =  seed  *  0x9E3779B97F4A7C15ULL   +  i  +  1;
+        workers[i].games  =  games  /  threads   +  ( i  <  games  %  threads);
+        workers[i].disconnectrate  =   disconnectrate;
+        workers[i].verify  =  verify;
+        workers[i].maxplayers  =  maxplayers;
+        workers[i].boardsize   =  boardsize;
+        pthread_create( &handles[i],  NULL,   workerthread,  &workers[i]);
+    }
+
+    Worker  total;
+    memset( &total,  0,   sizeof( total));
+    for ( int i  =  0;   i  <  threads;  i++)  {
+        pthread_join( handles[i],   NULL);
+        total.wins  +=  workers[i].wins;
+        total.draws  +=   workers[i].draws;
+        total.deaddraws  +=  workers[i].deaddraws;
+        total.abandoned  +=  workers[i].abandoned;
+        total.moves  +=   workers[i].moves;
+        total.disconnects  +=  workers[i].disconnects;
+        total.mismatches  +=   workers[i].mismatches;
+        total.virtualms  +=  workers[i].virtualms;
+    }
+    clock_gettime( CLOCK_MONOTONIC,   &end);
+    double  elapsed  =  ( end.tv_sec  -  start.tv_sec)   +  ( end.tv_nsec  -  start.tv_nsec)  /  1e9;
+
+    printf( "Simulated %ld games of up to %d players on %dx%d on %d threads (seed %llu) in %.3f s\n",
+            games,  maxplayers,   boardsize,  boardsize,  threads,   seed,  elapsed);
+    printf( "  %.0f games/s, %.0f moves/s\n",   games  /  elapsed,  total.moves   /  elapsed);
+    printf( "  wins %ld, draws %ld (%ld before the board filled), abandoned %ld, disconnects %ld\n",
+            total.wins,  total.draws,   total.deaddraws,  total.abandoned,   total.disconnects);
+    printf( "  average virtual game time %.1f s\n",   games  ?  total.virtualms  /  1000.0  /  games   :  0.0);
+    if ( verify)  printf( "  engine/oracle mismatches: %ld\n",   total.mismatches);
+
+    free( workers);
+    free( handles);
+    return  total.mismatches  ?  1  :   0;
+}
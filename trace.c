@@ -0,0 +1,79 @@
+#include "trace.h"
+#include  <sys/syscall.h>
+
+static TraceRegion  *traceregion;
+static const int  *tracegame;
+static __thread  TraceBuffer  *tracebuffer;
+static __thread  int  traceoff;
+
+uint64_t  tracenow()  {
+    struct timespec  now;
+    clock_gettime( CLOCK_MONOTONIC,   &now);
+    return  ( uint64_t)now.tv_sec  *  1000000000ull   +  now.tv_nsec;
+}
+
+void  traceopen( const char  *name,   const int  *game)  {
+    shm_unlink( name);
+    int  fd  =  shm_open( name,   O_CREAT  |  O_RDWR  |  O_CLOEXEC,  0666);
+    if ( fd  ==  -1)  return;
+    if ( ftruncate( fd,   sizeof( TraceRegion))  ==  -1)  {
+        close( fd);
+        return;
+    }
+    TraceRegion  *mapped  =  mmap( NULL,   sizeof( TraceRegion),  PROT_READ  |  PROT_WRITE,   MAP_SHARED,  fd,  0);
+    close( fd);
+    if ( mapped  ==  MAP_FAILED)  return;
+
+    mapped->magic  =   TRACE_MAGIC;
+    traceregion  =  mapped;
+    tracegame  =   game;
+}
+
+static int  traceownerlive( uint64_t  owner)  {
+    if ( owner  ==  0)  return  0;
+    return  syscall( SYS_tgkill,  ( pid_t)( owner  >>  32),   ( pid_t)( owner  &  0xffffffff),  0)  ==  0   ||  errno  ==  EPERM;
+}
+
+void  traceclaim( const char  *label,   int  id)  {
+    tracebuffer  =  NULL;
+    traceoff   =  1;
+    if ( !traceregion)  return;
+
+    int  pid  =  getpid();
+    int   tid  =  syscall( SYS_gettid);
+    uint64_t  mine  =  ( uint64_t)pid  <<  32   |  ( uint32_t)tid;
+    uint32_t  first  =  __atomic_fetch_add( &traceregion->claimed,   1,  __ATOMIC_RELAXED);
+    TraceBuffer  *buffer  =  NULL;
+    for ( int pass  =  0;   pass  <  2  &&  !buffer;   pass++)  {
+        for ( uint32_t i  =  0;   i  <  TRACE_BUFFERS  &&  !buffer;   i++)  {
+            TraceBuffer  *candidate  =  &traceregion->buffers[ ( first  +  i)   %  TRACE_BUFFERS];
+            uint64_t  owner  =  __atomic_load_n( &candidate->owner,   __ATOMIC_ACQUIRE);
+            if ( pass  ==  0  ?  owner  !=  0   :  traceownerlive( owner))  continue;
+            if ( __atomic_compare_exchange_n( &candidate->owner,   &owner,  mine,  0,   __ATOMIC_ACQ_REL,  __ATOMIC_RELAXED))  buffer   =  candidate;
+        }
+    }
+    if ( !buffer)  return;
+
+    __atomic_store_n( &buffer->head,   0,  __ATOMIC_RELAXED);
+    buffer->pid  =  pid;
+    buffer->tid   =  tid;
+    if ( id  >=  0)  snprintf( buffer->label,  sizeof( buffer->label),   "%s %d",  label,  id);
+    else  snprintf( buffer->label,   sizeof( buffer->label),  "%s",  label);
+    tracebuffer  =  buffer;
+    traceoff   =  0;
+}
+
+void  traceevent( int  point,   uint64_t  start,  uint64_t  duration,   int  arg)  {
+    if ( !traceregion  ||  traceoff)  return;
+    if ( !tracebuffer)  traceclaim( "thread",  -1);
+    if ( !tracebuffer)  return;
+
+    uint32_t  head  =  tracebuffer->head;
+    TraceEvent  *event  =  &tracebuffer->events[ head  %   TRACE_EVENTS];
+    event->timestamp  =  start;
+    event->duration   =  duration;
+    event->game  =  tracegame  ?  *tracegame  :   0;
+    event->arg  =  arg;
+    event->point   =  point;
+    __atomic_store_n( &tracebuffer->head,   head  +  1,  __ATOMIC_RELEASE);
+}
@@ -0,0 +1,76 @@
+#ifndef TRACE_H
+#define  TRACE_H
+
+#include "common.h"
+
+#define TRACE_SHM_NAME  "/game_trace_v1"
+#define  TRACE_MAGIC  0x54524331
+#define TRACE_BUFFERS   256
+#define  TRACE_EVENTS  2048
+
+#define TRACE_ACCEPT  0
+#define  TRACE_FORK  1
+#define TRACE_WELCOME_WAIT   2
+#define  TRACE_WELCOME  3
+#define TRACE_LOBBY_WAIT  4
+#define  TRACE_TURN  5
+#define TRACE_TURN_GRANT   6
+#define  TRACE_BOARD_SEND  7
+#define TRACE_MOVE_RECEIVE  8
+#define  TRACE_MUTEX_WAIT   9
+#define TRACE_VALIDATE  10
+#define  TRACE_CHECKWIN  11
+#define TRACE_SCORE_SAVE   12
+#define  TRACE_HISTORY  13
+#define TRACE_GAME_OVER_WAIT  14
+#define  TRACE_POINTS   15
+
+static const char  *const  tracepointnames[ TRACE_POINTS]  =  {
+    "accept",  "fork",   "welcome wait",  "welcome",  "lobby wait",  "turn",   "turn grant",  "board send",
+    "move receive",   "gamemutex wait",  "validate",  "checkwin",   "score save",  "history append",  "game over wait"
+};
+
+typedef  struct {
+    uint64_t  timestamp;
+    uint64_t   duration;
+    int  game;
+    int   arg;
+    int  point;
+    int   pad;
+}  TraceEvent;
+
+typedef struct  {
+    uint64_t  owner;
+    int  pid;
+    int   tid;
+    char  label[32];
+    uint32_t  head;
+    TraceEvent   events[TRACE_EVENTS];
+}  TraceBuffer;
+
+typedef  struct {
+    uint32_t  magic;
+    uint32_t   claimed;
+    TraceBuffer  buffers[TRACE_BUFFERS];
+}  TraceRegion;
+
+uint64_t  tracenow();
+void  traceopen( const char  *name,   const int  *game);
+void  traceclaim( const char  *label,   int  id);
+void  traceevent( int  point,   uint64_t  start,  uint64_t  duration,   int  arg);
+
+#ifdef TRACE
+#define TRACE_OPEN( name,  game)   traceopen( name,  game)
+#define  TRACE_THREAD( label,   id)  traceclaim( label,  id)
+#define TRACE_BEGIN( start)  uint64_t  start  =   tracenow()
+#define  TRACE_END( point,  start,   arg)  traceevent( point,  start,  tracenow()  -   start,  arg)
+#define TRACE_MARK( point,   arg)  traceevent( point,  tracenow(),   0,  arg)
+#else
+#define TRACE_OPEN( name,  game)   do  {}  while ( 0)
+#define  TRACE_THREAD( label,   id)  do  {}  while ( 0)
+#define TRACE_BEGIN( start)  do  {}  while ( 0)
+#define  TRACE_END( point,  start,   arg)  do  {}  while ( 0)
+#define TRACE_MARK( point,   arg)  do  {}  while ( 0)
+#endif
+
+#endif
@@ -0,0 +1,102 @@
+#include "trace.h"
+
+TraceBuffer  snapshot;
+
+void  writeevent( FILE  *out,   int  *first,  const TraceBuffer  *buffer,   const TraceEvent  *event,  uint64_t  origin)  {
+    const char  *name  =  event->point  >=  0  &&  event->point   <  TRACE_POINTS  ?  tracepointnames[ event->point]  :  "unknown";
+    double  timestamp  =  ( event->timestamp  -   origin)  /  1000.0;
+
+    fprintf( out,  "%s\n{\"name\":\"%s\",\"cat\":\"game\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,",
+             *first  ?  ""  :   ",",  name,  event->game,   buffer->tid,  timestamp);
+    if ( event->duration  >  0)  {
+        fprintf( out,  "\"ph\":\"X\",\"dur\":%.3f,",   event->duration  /  1000.0);
+    }  else  {
+        fprintf( out,  "\"ph\":\"i\",\"s\":\"t\",");
+    }
+    fprintf( out,  "\"args\":{\"arg\":%d,\"pid\":%d}}",   event->arg,  buffer->pid);
+    *first  =   0;
+}
+
+void  writelabels( FILE  *out,   int  *first,  const TraceBuffer  *buffer,   int  game)  {
+    fprintf( out,  "%s\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"Game %d\"}}",
+             *first  ?  ""  :   ",",  game,  game);
+    fprintf( out,  ",\n{\"name\":\"process_sort_index\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"sort_index\":%d}}",   game,  game);
+    fprintf( out,  ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s (pid %d)\"}}",
+             game,  buffer->tid,   buffer->label,  buffer->pid);
+    *first  =  0;
+}
+
+int  main( int  argc,   char  *argv[])  {
+    char  shmname[ 64]  =  TRACE_SHM_NAME;
+    int  onlygame  =  -1;
+    int  option;
+    while ( ( option  =  getopt( argc,  argv,   "s:g:"))  !=  -1)  {
+        switch ( option)  {
+            case  's':  snprintf( shmname,  sizeof( shmname),   "%s_%d",  TRACE_SHM_NAME,   atoi( optarg));  break;
+            case  'g':  onlygame  =   atoi( optarg);  break;
+            default:
+                fprintf( stderr,  "Usage: %s [-s shard] [-g game] [OUTPUT]\n",   argv[0]);
+                return  1;
+        }
+    }
+    const char  *outpath  =  optind  <  argc  ?  argv[optind]   :  "trace.json";
+
+    int  fd  =  shm_open( shmname,   O_RDONLY,  0);
+    if ( fd  ==  -1)  {
+        fprintf( stderr,  "No trace buffers at %s - was the server built with TRACEFLAGS=-DTRACE?\n",   shmname);
+        return  1;
+    }
+    TraceRegion  *region  =  mmap( NULL,   sizeof( TraceRegion),  PROT_READ,   MAP_SHARED,  fd,  0);
+    close( fd);
+    if ( region  ==  MAP_FAILED  ||  region->magic   !=  TRACE_MAGIC)  {
+        fprintf( stderr,  "%s is not a trace region.\n",   shmname);
+        return  1;
+    }
+
+    uint64_t  origin  =  UINT64_MAX;
+    for ( int i  =  0;   i  <  TRACE_BUFFERS;  i++)  {
+        const TraceBuffer  *buffer  =  &region->buffers[i];
+        uint32_t  head  =  __atomic_load_n( &buffer->head,   __ATOMIC_ACQUIRE);
+        if ( buffer->pid  ==  0  ||   head  ==  0)  continue;
+        uint32_t  oldest  =  head  >  TRACE_EVENTS  ?  head  -   TRACE_EVENTS  :  0;
+        if ( buffer->events[ oldest  %  TRACE_EVENTS].timestamp   <  origin)  origin  =  buffer->events[ oldest  %   TRACE_EVENTS].timestamp;
+    }
+
+    FILE  *out  =  fopen( outpath,   "w");
+    if ( !out)  {
+        perror( "fopen");
+        return  1;
+    }
+    fprintf( out,  "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+    int  first  =  1;
+    long  written  =  0;
+    int  threads  =  0;
+    for ( int i  =  0;   i  <  TRACE_BUFFERS;  i++)  {
+        uint32_t  head  =  __atomic_load_n( &region->buffers[i].head,   __ATOMIC_ACQUIRE);
+        if ( region->buffers[i].pid  ==  0  ||   head  ==  0)  continue;
+        memcpy( &snapshot,   &region->buffers[i],  sizeof( TraceBuffer));
+
+        uint32_t  after  =  __atomic_load_n( &region->buffers[i].head,   __ATOMIC_ACQUIRE);
+        uint32_t  oldest  =  after  >  TRACE_EVENTS  ?  after  -   TRACE_EVENTS  :  0;
+        if ( after  <  head)  continue;
+        threads++;
+
+        int  labelled  =  -1;
+        for ( uint32_t  index  =  oldest;   index  <  head;  index++)  {
+            const TraceEvent  *event  =  &snapshot.events[ index  %   TRACE_EVENTS];
+            if ( onlygame  !=  -1  &&  event->game   !=  onlygame)  continue;
+            if ( event->game  !=  labelled)  {
+                writelabels( out,  &first,   &snapshot,  event->game);
+                labelled  =   event->game;
+            }
+            writeevent( out,  &first,  &snapshot,   event,  origin);
+            written++;
+        }
+    }
+    fprintf( out,  "\n]}\n");
+    fclose( out);
+
+    printf( "Wrote %ld events from %d threads to %s\n",   written,  threads,  outpath);
+    return  0;
+}
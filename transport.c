@@ -0,0 +1,310 @@
+#include "transport.h"
+
+static const char  *const  transportnames[]  =  { "tcp",   "unix",  "ring"};
+
+int  transportkind( const char  *name)  {
+    for ( int kind  =  0;   kind  <  3;  kind++)  {
+        if ( strcmp( name,  transportnames[kind])   ==  0)  return  kind;
+    }
+    return  -1;
+}
+
+const char  *transportname( int  kind)  {
+    return  kind  >=  0  &&  kind  <  3  ?  transportnames[kind]   :  "unknown";
+}
+
+void  transportpath( int  kind,   int  port,  char  *path,   size_t  length)  {
+    snprintf( path,  length,   kind  ==  TRANSPORT_RING  ?  RING_PATH_FORMAT  :   UNIX_PATH_FORMAT,  port);
+}
+
+int  transportlisten( const char  *path,   int  backlog)  {
+    struct sockaddr_un  address;
+    memset( &address,  0,   sizeof( address));
+    address.sun_family  =  AF_UNIX;
+    strncpy( address.sun_path,   path,  sizeof( address.sun_path)  -   1);
+
+    int  fd  =  socket( AF_UNIX,   SOCK_SEQPACKET  |  SOCK_CLOEXEC,  0);
+    if ( fd  ==  -1)  return  -1;
+    unlink( path);
+    if ( bind( fd,  ( struct sockaddr  *)&address,   sizeof( address))  ==  -1  ||   listen( fd,  backlog)  ==  -1)  {
+        close( fd);
+        return  -1;
+    }
+    return  fd;
+}
+
+void  transportattach( Connection  *connection,   int  kind,  int  fd)  {
+    memset( connection,  0,   sizeof( Connection));
+    connection->kind  =  kind;
+    connection->fd   =  fd;
+    connection->wakefd  =  -1;
+    connection->peerwakefd   =  -1;
+}
+
+static void  releasering( Connection  *connection,   Ring  *rings)  {
+    if ( rings  !=  MAP_FAILED)  munmap( rings,   2  *  sizeof( Ring));
+    if ( connection->wakefd  !=  -1)  close( connection->wakefd);
+    if ( connection->peerwakefd  !=  -1)  close( connection->peerwakefd);
+    transportattach( connection,   TRANSPORT_RING,  connection->fd);
+}
+
+int  transportoffer( Connection  *connection,   int  fd)  {
+    transportattach( connection,   TRANSPORT_RING,  fd);
+
+    int  memoryfd  =  memfd_create( "mttt-ring",   MFD_CLOEXEC);
+    if ( memoryfd  ==  -1  ||  ftruncate( memoryfd,   2  *  sizeof( Ring))  ==  -1)  {
+        if ( memoryfd  !=  -1)  close( memoryfd);
+        return  -1;
+    }
+    Ring  *rings  =  mmap( NULL,   2  *  sizeof( Ring),  PROT_READ  |  PROT_WRITE,   MAP_SHARED,  memoryfd,  0);
+    connection->wakefd  =  eventfd( 0,   EFD_NONBLOCK  |  EFD_CLOEXEC);
+    connection->peerwakefd   =  eventfd( 0,  EFD_NONBLOCK  |  EFD_CLOEXEC);
+    if ( rings  ==  MAP_FAILED  ||  connection->wakefd  ==  -1   ||  connection->peerwakefd  ==  -1)  {
+        close( memoryfd);
+        releasering( connection,   rings);
+        return  -1;
+    }
+    connection->out  =  &rings[0];
+    connection->in   =  &rings[1];
+
+    int  fds[3]  =  { memoryfd,   connection->peerwakefd,  connection->wakefd};
+    char  control[ CMSG_SPACE( sizeof( fds))];
+    char  tag  =  'R';
+    struct iovec  vector  =  { &tag,   1};
+    struct msghdr  message;
+    memset( &message,  0,   sizeof( message));
+    memset( control,   0,  sizeof( control));
+    message.msg_iov  =  &vector;
+    message.msg_iovlen  =   1;
+    message.msg_control  =  control;
+    message.msg_controllen   =  sizeof( control);
+
+    struct cmsghdr  *header  =  CMSG_FIRSTHDR( &message);
+    header->cmsg_level  =  SOL_SOCKET;
+    header->cmsg_type   =  SCM_RIGHTS;
+    header->cmsg_len  =  CMSG_LEN( sizeof( fds));
+    memcpy( CMSG_DATA( header),   fds,  sizeof( fds));
+
+    int  result  =  sendmsg( fd,  &message,   MSG_NOSIGNAL)  ==  1  ?  0  :   -1;
+    close( memoryfd);
+    if ( result  ==  -1)  releasering( connection,   rings);
+    return  result;
+}
+
+static int  receivering( Connection  *connection)  {
+    char  probe;
+    struct iovec  probevector  =  { &probe,   1};
+    struct msghdr  probemessage;
+    memset( &probemessage,  0,   sizeof( probemessage));
+    probemessage.msg_iov  =  &probevector;
+    probemessage.msg_iovlen   =  1;
+    if ( recvmsg( connection->fd,  &probemessage,   MSG_PEEK)  <=  0)  return  -1;
+    if ( !( probemessage.msg_flags  &  MSG_CTRUNC))  {
+        connection->kind  =  TRANSPORT_UNIX;
+        return  0;
+    }
+
+    int  fds[3];
+    char  control[ CMSG_SPACE( sizeof( fds))];
+    char  tag;
+    struct iovec  vector  =  { &tag,   1};
+    struct msghdr  message;
+    memset( &message,  0,   sizeof( message));
+    message.msg_iov  =  &vector;
+    message.msg_iovlen  =   1;
+    message.msg_control  =  control;
+    message.msg_controllen   =  sizeof( control);
+
+    if ( recvmsg( connection->fd,  &message,   MSG_CMSG_CLOEXEC)  <=  0)  return  -1;
+    struct cmsghdr  *header  =  CMSG_FIRSTHDR( &message);
+    if ( !header  ||  header->cmsg_type   !=  SCM_RIGHTS  ||  header->cmsg_len  !=  CMSG_LEN( sizeof( fds)))  return  -1;
+    memcpy( fds,   CMSG_DATA( header),  sizeof( fds));
+
+    Ring  *rings  =  mmap( NULL,   2  *  sizeof( Ring),  PROT_READ  |  PROT_WRITE,   MAP_SHARED,  fds[0],  0);
+    close( fds[0]);
+    connection->wakefd  =  fds[1];
+    connection->peerwakefd   =  fds[2];
+    if ( rings  ==  MAP_FAILED)  return  -1;
+    connection->in  =  &rings[0];
+    connection->out   =  &rings[1];
+    return  0;
+}
+
+int  transportconnect( Connection  *connection,   int  kind,  const char  *address,   int  port)  {
+    if ( kind  ==  TRANSPORT_TCP)  {
+        struct sockaddr_in  serveraddr;
+        memset( &serveraddr,  0,   sizeof( serveraddr));
+        serveraddr.sin_family  =  AF_INET;
+        serveraddr.sin_port   =  htons( port);
+        if ( inet_pton( AF_INET,  address,   &serveraddr.sin_addr)  <=  0)  {
+            errno  =  EINVAL;
+            return  -1;
+        }
+        int  fd  =  socket( AF_INET,   SOCK_STREAM,  0);
+        if ( fd  <  0)  return  -1;
+        if ( connect( fd,  ( struct sockaddr  *)&serveraddr,   sizeof( serveraddr))  <  0)  {
+            close( fd);
+            return  -1;
+        }
+        transportattach( connection,  kind,   fd);
+        return  0;
+    }
+
+    struct sockaddr_un  unixaddr;
+    memset( &unixaddr,  0,   sizeof( unixaddr));
+    unixaddr.sun_family  =  AF_UNIX;
+    transportpath( kind,   port,  unixaddr.sun_path,  sizeof( unixaddr.sun_path));
+
+    int  fd  =  socket( AF_UNIX,   SOCK_SEQPACKET  |  SOCK_CLOEXEC,  0);
+    if ( fd  <  0)  return  -1;
+    if ( connect( fd,  ( struct sockaddr  *)&unixaddr,   sizeof( unixaddr))  <  0)  {
+        close( fd);
+        return  -1;
+    }
+    transportattach( connection,  kind,   fd);
+    if ( kind  ==  TRANSPORT_RING  &&  receivering( connection)   ==  -1)  {
+        transportclose( connection);
+        errno  =  EPROTO;
+        return  -1;
+    }
+    return  0;
+}
+
+static void  wakepeer( Connection  *connection,   uint32_t  *waiting)  {
+    __atomic_thread_fence( __ATOMIC_SEQ_CST);
+    if ( __atomic_load_n( waiting,   __ATOMIC_RELAXED)  &&  __atomic_exchange_n( waiting,   0,  __ATOMIC_RELAXED))  {
+        uint64_t  one  =  1;
+        if ( write( connection->peerwakefd,   &one,  sizeof( one))  <  0)  {}
+    }
+}
+
+static size_t  ringwrite( Connection  *connection,   const char  *data,  size_t  length)  {
+    Ring  *ring  =  connection->out;
+    uint32_t  head  =  ring->head;
+    uint32_t  space  =  RING_SIZE  -   ( head  -  __atomic_load_n( &ring->tail,  __ATOMIC_ACQUIRE));
+    size_t  count  =  length  <  space  ?  length   :  space;
+    if ( count  ==  0)  return  0;
+
+    uint32_t  offset  =  head  %  RING_SIZE;
+    size_t  first  =  count  <  RING_SIZE  -  offset  ?  count   :  RING_SIZE  -  offset;
+    memcpy( ring->data  +  offset,   data,  first);
+    memcpy( ring->data,  data  +  first,   count  -  first);
+    __atomic_store_n( &ring->head,   head  +  count,  __ATOMIC_RELEASE);
+    wakepeer( connection,   &ring->readerwaiting);
+    return  count;
+}
+
+static size_t  ringread( Connection  *connection,   char  *data,  size_t  length)  {
+    Ring  *ring  =  connection->in;
+    uint32_t  tail  =  ring->tail;
+    uint32_t  available  =  __atomic_load_n( &ring->head,   __ATOMIC_ACQUIRE)  -  tail;
+    size_t  count  =  length  <  available  ?  length   :  available;
+    if ( count  ==  0)  return  0;
+
+    uint32_t  offset  =  tail  %  RING_SIZE;
+    size_t  first  =  count  <  RING_SIZE  -  offset  ?  count   :  RING_SIZE  -  offset;
+    memcpy( data,  ring->data  +  offset,   first);
+    memcpy( data  +  first,   ring->data,  count  -  first);
+    __atomic_store_n( &ring->tail,   tail  +  count,  __ATOMIC_RELEASE);
+    wakepeer( connection,   &ring->writerwaiting);
+    return  count;
+}
+
+static int  ringready( Connection  *connection,   int  writable)  {
+    if ( writable)  {
+        Ring  *ring  =  connection->out;
+        return  ring->head  -  __atomic_load_n( &ring->tail,   __ATOMIC_ACQUIRE)  <  RING_SIZE;
+    }
+    Ring  *ring  =  connection->in;
+    return  __atomic_load_n( &ring->head,   __ATOMIC_ACQUIRE)  !=  ring->tail;
+}
+
+int  transportreadfd( Connection  *connection)  {
+    if ( connection->kind  !=  TRANSPORT_RING)  return  connection->fd;
+
+    __atomic_store_n( &connection->in->readerwaiting,  1,   __ATOMIC_SEQ_CST);
+    __atomic_thread_fence( __ATOMIC_SEQ_CST);
+    if ( ringready( connection,   0))  eventfd_write( connection->wakefd,  1);
+    return  connection->wakefd;
+}
+
+int  transportwait( Connection  *connection,   int  writable,  int  timeoutms)  {
+    if ( connection->kind  !=  TRANSPORT_RING)  {
+        struct pollfd  pollfd  =  { connection->fd,   writable  ?  POLLOUT  :  POLLIN,  0};
+        int  result  =  poll( &pollfd,  1,   timeoutms);
+        if ( result  <  0)  return  errno  ==  EINTR  ?  0   :  -1;
+        return  result;
+    }
+
+    static int  spinlimit  =  -1;
+    if ( spinlimit  ==  -1)  spinlimit  =  sysconf( _SC_NPROCESSORS_ONLN)   >  1  ?  RING_SPIN  :  0;
+    for ( int spin  =  0;   spin  <  spinlimit;  spin++)  {
+        if ( ringready( connection,   writable))  return  1;
+        cpurelax();
+    }
+
+    uint32_t  *waiting  =  writable  ?  &connection->out->writerwaiting   :  &connection->in->readerwaiting;
+    __atomic_store_n( waiting,  1,   __ATOMIC_SEQ_CST);
+    __atomic_thread_fence( __ATOMIC_SEQ_CST);
+    if ( ringready( connection,   writable))  {
+        __atomic_store_n( waiting,  0,   __ATOMIC_RELAXED);
+        return  1;
+    }
+
+    struct pollfd  pollfds[2]  =  { { connection->wakefd,   POLLIN,  0},  { connection->fd,  POLLIN,   0}};
+    int  result  =  poll( pollfds,  2,   timeoutms);
+    if ( result  <  0)  return  errno  ==  EINTR  ?  0   :  -1;
+
+    uint64_t  count;
+    if ( pollfds[0].revents  &  POLLIN)  {
+        if ( read( connection->wakefd,   &count,  sizeof( count))  <  0)  {}
+    }
+    if ( pollfds[1].revents  &&  !ringready( connection,   writable))  {
+        char  probe;
+        if ( recv( connection->fd,  &probe,   1,  MSG_PEEK  |  MSG_DONTWAIT)  <=   0)  return  -1;
+    }
+    return  ringready( connection,   writable);
+}
+
+ssize_t  transportsend( Connection  *connection,   const void  *data,  size_t  length,   int  nonblocking)  {
+    if ( connection->kind  !=  TRANSPORT_RING)  {
+        return  send( connection->fd,  data,   length,  MSG_NOSIGNAL  |  ( nonblocking  ?  MSG_DONTWAIT   :  0));
+    }
+
+    size_t  sent  =  0;
+    while ( 1)  {
+        sent  +=  ringwrite( connection,   ( const char  *)data  +  sent,  length  -   sent);
+        if ( sent  ==  length  ||  nonblocking)   break;
+        if ( transportwait( connection,   1,  -1)  ==  -1)  {
+            errno  =  EPIPE;
+            return  -1;
+        }
+    }
+    if ( sent  ==  0  &&  length  >  0)  {
+        errno  =  EAGAIN;
+        return  -1;
+    }
+    return  sent;
+}
+
+ssize_t  transportrecv( Connection  *connection,   void  *data,  size_t  length)  {
+    if ( connection->kind  !=  TRANSPORT_RING)  {
+        return  read( connection->fd,  data,   length);
+    }
+
+    while ( 1)  {
+        size_t  count  =  ringread( connection,   data,  length);
+        if ( count  >  0)  return  count;
+        if ( transportwait( connection,   0,  -1)  ==  -1)  return  0;
+    }
+}
+
+void  transportclose( Connection  *connection)  {
+    if ( connection->kind  ==  TRANSPORT_RING  &&  connection->in)  {
+        munmap( connection->in  <  connection->out  ?  connection->in   :  connection->out,  2  *  sizeof( Ring));
+    }
+    if ( connection->wakefd  !=  -1)  close( connection->wakefd);
+    if ( connection->peerwakefd  !=  -1)  close( connection->peerwakefd);
+    if ( connection->fd  !=  -1)  close( connection->fd);
+    transportattach( connection,   connection->kind,  -1);
+}
@@ -0,0 +1,20 @@
+#ifndef TRANSPORT_H
+#define  TRANSPORT_H
+
+#include "common.h"
+#include  <sys/un.h>
+
+int  transportkind( const char  *name);
+const char  *transportname( int  kind);
+void  transportpath( int  kind,   int  port,  char  *path,   size_t  length);
+int  transportlisten( const char  *path,   int  backlog);
+void  transportattach( Connection  *connection,   int  kind,  int  fd);
+int  transportoffer( Connection  *connection,   int  fd);
+int  transportconnect( Connection  *connection,   int  kind,  const char  *address,   int  port);
+ssize_t  transportsend( Connection  *connection,   const void  *data,  size_t  length,   int  nonblocking);
+ssize_t  transportrecv( Connection  *connection,   void  *data,  size_t  length);
+int  transportwait( Connection  *connection,   int  writable,  int  timeoutms);
+int  transportreadfd( Connection  *connection);
+void  transportclose( Connection  *connection);
+
+#endif